@@ -1,6 +1,7 @@
 #include <tools/Config.hpp>
 #include <tools/Parallel.hpp>
 #include <tools/ErrorAnalysis.hpp>
+#include <tools/RandomStream.hpp>
 #include <model/NS.hpp>
 #include <mcmc/MCMC.hpp>
 #include <mcmc/MetropolisHastings.hpp>
@@ -18,6 +19,7 @@ int main(int argc, char** argv)
 	Config cfg (argc, argv);
 	Parallel par;
 	par.mpi_init(argc, argv);
+	RandomStream::init_seed(cfg, par);
 
 	if (par.status == MPI_ADAPT_STATUS_JOINING) {
 		cout << "JOINING Rank " << par.rank << " arrived!" << endl;
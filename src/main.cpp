@@ -1,11 +1,17 @@
 #include <tools/Config.hpp>
 #include <tools/Parallel.hpp>
 #include <tools/ErrorAnalysis.hpp>
+#include <tools/RandomStream.hpp>
 #include <model/NS.hpp>
 #include <mcmc/MCMC.hpp>
 #include <mcmc/MetropolisHastings.hpp>
 #include <mcmc/ParallelTempering.hpp>
+#include <mcmc/DelayedAcceptance.hpp>
+#include <mcmc/MultilevelMCMC.hpp>
+#include <mcmc/PrefetchingMCMC.hpp>
+#include <mcmc/MultipleTryMetropolis.hpp>
 #include <surrogate/SGI.hpp>
+#include <surrogate/SGCT.hpp>
 
 #include <iostream>
 #include <fstream>
@@ -20,6 +26,7 @@ int main(int argc, char** argv)
 	Config cfg (argc, argv);
 	Parallel par;
 	par.mpi_init(argc, argv);
+	RandomStream::init_seed(cfg, par); // all random streams derive from this seed
 
 	/*************************
 	 * Initialization Phase
@@ -33,15 +40,31 @@ int main(int argc, char** argv)
 	NS ns (cfg);
 	// Surrogate model
 	SGI sgi (cfg, par, ns);
+	SGCT sgct (cfg, par, ns);
+	bool is_sgct = (cfg.get_param_string("global_surrogate") == "sgct");
+	if (!is_sgct && (cfg.get_param_string("global_surrogate") != "sgi")) {
+		par.info();
+		printf("ERROR: surrogate %s is not supported (sgi|sgct). Program abort!\n",
+				cfg.get_param_string("global_surrogate").c_str());
+		exit(EXIT_FAILURE);
+	}
+	ForwardModel& surrogate = is_sgct ? static_cast<ForwardModel&>(sgct) : sgi;
 	// Error analysis object
-	ErrorAnalysis ea (cfg, par, ns, sgi);
-	// Only Master need test points
-	if (par.is_master()) {
-		// Produce visualization with default obs locations (true locations)
-		ns.sim();
+	ErrorAnalysis ea (cfg, par, ns, surrogate);
+	// Produce visualization with default obs locations (true locations)
+	if (par.is_master()) ns.sim();
+	// Surplus-based error estimate replaces test points as SGI stopping criterion
+	string estimator = is_sgct ? "test" : cfg.get_param_string("sgi_error_estimator");
+	// Test points are still needed to check coarsening, precision and compiled evaluator
+	bool is_test_points = (estimator == "test") || cfg.get_param_bool("sgi_is_coarsen") ||
+			(cfg.get_param_string("sgi_alpha_precision") == "single") || (cfg.get_param_string("sgi_eval_lib") != "");
+	// Test points: full model runs are shared by all ranks
+	if (is_test_points) {
 		ea.add_test_points(cfg.get_param_sizet("ea_num_test_points"), cfg.get_param_string("ea_test_point_file"));
-		ea.write_test_points(cfg.get_param_string("global_output_path") + "/test_points_r" + std::to_string(par.rank) + ".txt");
-		ea.print_test_points();
+		if (par.is_master()) {
+			ea.write_test_points(cfg.get_param_string("global_output_path") + "/test_points_r" + std::to_string(par.rank) + ".txt");
+			ea.print_test_points();
+		}
 	}
 	MPI_Barrier(MPI_COMM_WORLD);
 
@@ -51,15 +74,73 @@ int main(int argc, char** argv)
 	double tol = cfg.get_param_double("sgi_tol");
 	std::size_t ITERMIN = cfg.get_param_sizet("sgi_build_itermin");
 	std::size_t ITERMAX = cfg.get_param_sizet("sgi_build_itermax");
+	bool is_pipelined = !is_sgct && cfg.get_param_bool("sgi_is_pipelined");
 	for (std::size_t iter = 0; iter <= ITERMAX; ++iter) {
 		if (par.is_master()) {
 			printf("\nMain: SGI phase %lu | wall.time(sec) %.6f\n", iter, MPI_Wtime()-tic);
 		}
-		sgi.build();
-		if (ea.eval_model_master(tol) && iter >= ITERMIN) break;
+		if (is_pipelined) {
+			// Phase iter is computed while MASTER checks phase iter-1, and discarded if that converged
+			auto is_prev_converged = [&]() { return ea.eval_model_local(tol) && (iter-1 >= ITERMIN); };
+			if (sgi.build_pipelined(is_prev_converged)) break;
+			continue;
+		}
+		if (is_sgct) {
+			sgct.build();
+		} else {
+			sgi.build();
+		}
+		bool is_converged;
+		if (estimator == "test") {
+			is_converged = ea.eval_model_parallel(tol);
+		} else {
+			is_converged = (sgi.estimate_error(estimator == "surplus_pos") <= tol);
+		}
+		if (is_converged && iter >= ITERMIN) break;
 	}
 	MPI_Barrier(MPI_COMM_WORLD);
 
+	/****************************************************
+	 *	Surrogate Coarsening (optional)
+	 ****************************************************/
+	if (!is_sgct && cfg.get_param_bool("sgi_is_coarsen")) {
+		if (par.is_master()) {
+			printf("\nMain: SGI coarsening wall.time(sec) %.6f\n", MPI_Wtime()-tic);
+		}
+		double err_build = ea.eval_error_parallel();
+		sgi.coarsen(cfg.get_param_double("sgi_coarsen_threshold"));
+		double err_coarse = ea.eval_error_parallel();
+		// Accuracy guard: coarsened grid must be within tol, or at least not worse than before
+		sgi.coarsen_finalize(err_coarse <= fmax(tol, err_build));
+	}
+
+	/****************************************************
+	 *	Compiled Surrogate Evaluator (optional)
+	 ****************************************************/
+	if (!is_sgct && cfg.get_param_bool("sgi_is_export_eval")) {
+		sgi.write_evaluator(cfg.get_eval_src_fname());
+	}
+	if (!is_sgct && cfg.get_param_string("sgi_eval_lib") != "") {
+		sgi.load_evaluator(cfg.get_param_string("sgi_eval_lib"));
+		double err = ea.eval_error_parallel();
+		if (par.is_master()) {
+			printf("Main: SGI compiled evaluator | surrogate error %.8f\n", err);
+		}
+	}
+
+	/****************************************************
+	 *	Surrogate Surplus Precision (optional)
+	 ****************************************************/
+	if (!is_sgct && cfg.get_param_string("sgi_alpha_precision") == "single") {
+		double err_double = ea.eval_error_parallel();
+		sgi.reduce_precision();
+		double err_single = ea.eval_error_parallel();
+		if (par.is_master()) {
+			printf("Main: SGI single precision alphas | error change %.3e (double %.8f, single %.8f)\n",
+					err_single-err_double, err_double, err_single);
+		}
+	}
+
 	/**************
 	 * MCMC Phase
 	 **************/
@@ -68,10 +149,38 @@ int main(int argc, char** argv)
 	if (par.is_master()) {
 		printf("\nMain: MCMC phase wall.time(sec) %.6f\n", MPI_Wtime()-tic);
 	}
+	// One copy of the surrogate per node, or partitioned over all ranks
+	if (!is_sgct && cfg.get_param_bool("sgi_is_shared")) sgi.share_alphas();
+	if (!is_sgct && cfg.get_param_bool("sgi_is_distributed")) sgi.distribute_alphas();
+#if (SGI_DEBUG==1) // Debug only: batched posterior must match the point-wise one for the final alpha layout
+	if (!is_sgct) sgi.check_posterior_batch(16);
+#endif
 	// MCMC
-	MCMC* mcmc = new ParallelTempering(cfg, par, sgi);
+	MCMC* mcmc;
+	string method = cfg.get_param_string("mcmc_method");
+	if (method == "pt") {
+		mcmc = new ParallelTempering(cfg, par, surrogate);
+	} else if (method == "mh") {
+		mcmc = new MetropolisHastings(cfg, par, surrogate);
+	} else if (method == "da") {
+		mcmc = new DelayedAcceptance(cfg, par, surrogate, ns);
+	} else if (method == "ml") {
+		mcmc = new MultilevelMCMC(cfg, par, ns);
+	} else if (method == "pf") {
+		mcmc = new PrefetchingMCMC(cfg, par, ns);
+	} else if (method == "mtm") {
+		mcmc = new MultipleTryMetropolis(cfg, par, surrogate);
+	} else {
+		par.info();
+		printf("ERROR: MCMC method %s is not supported (pt|mh|da|ml|pf|mtm). Program abort!\n", method.c_str());
+		exit(EXIT_FAILURE);
+	}
 	//mcmc->run(cfg.get_param_sizet("mcmc_num_samples"), sgi.get_maxpos() );
 	mcmc->run(cfg.get_param_sizet("mcmc_num_samples"), refloc );
+	// Ranks done with (or not in) MCMC keep answering distributed evaluations of others
+	sgi.serve_distributed();
+	sgi.free_shared(); // window must be freed before MPI finalize
+	delete mcmc;
 
 	if (par.is_master()) {
 		printf("\nMain: END wall.time(sec) %.6f\n", MPI_Wtime()-tic);
@@ -0,0 +1,143 @@
+// eBayes - Elastic Bayesian Inference Framework with iMPI
+// Copyright (C) 2015-today Ao Mo-Hellenbrand
+//
+// All copyrights remain with the respective authors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <mcmc/DelayedAcceptance.hpp>
+
+using namespace std;
+
+
+void DelayedAcceptance::run(
+			std::size_t num_samples,
+			std::vector<double> const& init_samplepos)
+{
+	// Each rank advances a block of MCMC chains
+	// Ranks with (mpirank >= num_chain_ranks) do NOT participate in MCMC computation
+	if (par.rank >= num_chain_ranks) return;
+
+	// Output files
+	for (size_t c=0; c < num_local_chains; c++)
+		open_output_file(c);
+
+	// Initialize starting points (surrogate posteriors), then their full model posteriors
+	std::size_t input_size = cfg.get_input_size();
+	initialize_samplepos(init_samplepos);
+	sur_pos.assign(states.begin() + input_size*num_local_chains, states.end());
+	for (size_t c=0; c < num_local_chains; c++)
+		sur_pos[c] = fmax(sur_pos[c], DBL_MIN);
+	double acc_modeltime = 0.0;
+	double tic = MPI_Wtime();
+	fullmodel.compute_posterior_batch(states, num_local_chains, &states[input_size*num_local_chains]);
+	acc_modeltime += MPI_Wtime() - tic;
+
+	vector< vector<double> > max_samplepos (num_local_chains);
+	for (size_t c=0; c < num_local_chains; c++) {
+		max_samplepos[c] = get_samplepos(c);
+		// Write initial MCMC sample
+		write_samplepos(c);
+	}
+
+	// Run the MCMC chains
+	for (int it=0; it < num_samples; ++it) {
+		// 1. Perform 1 two-stage MCMC step of all local chains
+		acc_modeltime += one_step_delayed(it);
+
+		for (size_t c=0; c < num_local_chains; c++) {
+			// 2. write result
+			write_samplepos(c);
+
+			// 3. Get max posterior and the corresponding sample point
+			if (get_pos(c) > max_samplepos[c].back()) {
+				max_samplepos[c] = get_samplepos(c);
+			}
+		}
+		// 4. keeping track
+#if (MCMC_PRINT_PROGRESS == 1)
+		if (par.is_master() && (it+1) % stoi(cfg.get_param_string("mcmc_progress_freq_step")) == 0) {
+			print_progress(it+1, acc_modeltime, max_samplepos[0]);
+		}
+#endif
+	}
+	// MAXPOS is written to the footer on close
+	for (size_t c=0; c < num_local_chains; c++)
+		close_output_file(c);
+
+	if (par.is_master()) {
+		par.info();
+		printf("MCMCDA: %lu proposals | stage 1 passed %.2f%% | stage 2 accepted %.2f%% of them | full model runs saved %.2f%%\n",
+				num_proposals, 100.0 * num_stage1 / num_proposals,
+				(num_stage1 > 0) ? 100.0 * num_stage2 / num_stage1 : 0.0,
+				100.0 * (num_proposals - num_stage1) / num_proposals);
+	}
+	return;
+}
+
+double DelayedAcceptance::one_step_delayed(std::size_t it)
+{
+	std::size_t input_size = cfg.get_input_size();
+	std::size_t nc = num_local_chains;
+
+	// 1. Draw a proposal of each chain
+	propose(it);
+
+	// 2. Stage 1: surrogate posteriors of all proposals at once
+	//    (all are evaluated, so every rank does the same # of surrogate evaluations)
+	double tic = MPI_Wtime();
+	model.compute_posterior_batch(proposals, nc, &proposal_pos[0]);
+	survivors.clear();
+	vector<double> acc (nc, 0.0);
+	for (std::size_t c=0; c < nc; c++) {
+		proposal_pos[c] = fmax(proposal_pos[c], DBL_MIN);
+		double acc1 = proposal_in[c] ? fmin(1.0, proposal_pos[c]/sur_pos[c]) : 0.0;
+		if (rngs[c].uniform() <= acc1) survivors.push_back(c);
+	}
+	num_proposals += nc;
+	num_stage1 += survivors.size();
+
+	// 3. Stage 2: full model posteriors of the survivors only
+	std::size_t ns = survivors.size();
+	if (ns > 0) {
+		full_batch.resize(input_size * ns);
+		full_pos.resize(ns);
+		for (std::size_t i=0; i < input_size; i++)
+			for (std::size_t k=0; k < ns; k++)
+				full_batch[i*ns + k] = proposals[i*nc + survivors[k]];
+		fullmodel.compute_posterior_batch(full_batch, ns, &full_pos[0]);
+	}
+	double* pos = &states[input_size*nc];
+	for (std::size_t k=0; k < ns; k++) {
+		std::size_t c = survivors[k];
+		// Correction: the surrogate ratio of stage 1 is divided out
+		acc[c] = fmin(1.0, (full_pos[k]/pos[c]) * (sur_pos[c]/proposal_pos[c]));
+		if (rngs[c].uniform() <= acc[c]) {
+			accept_proposal(c, full_pos[k]);
+			sur_pos[c] = proposal_pos[c];
+			num_stage2++;
+		}
+	}
+	double modeltime = MPI_Wtime() - tic;
+
+	// 4. Adaptive Metropolis: expected acceptance is acc1 * acc2,
+	//    i.e. acc2 for survivors and 0 for proposals rejected in stage 1
+	if (is_am) {
+		for (std::size_t c=0; c < nc; c++)
+			update_adaptation(c, acc[c]);
+		end_adaptation_step();
+	}
+	return modeltime;
+}
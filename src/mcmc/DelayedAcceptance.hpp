@@ -0,0 +1,72 @@
+// eBayes - Elastic Bayesian Inference Framework with iMPI
+// Copyright (C) 2015-today Ao Mo-Hellenbrand
+//
+// All copyrights remain with the respective authors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef MCMC_DELAYEDACCEPTANCE_HPP_
+#define MCMC_DELAYEDACCEPTANCE_HPP_
+
+#include <mcmc/MCMC.hpp>
+#include <tools/Config.hpp>
+#include <tools/Parallel.hpp>
+#include <model/ForwardModel.hpp>
+
+#include <mpi.h>
+#include <cmath>
+#include <cfloat>
+#include <string>
+#include <vector>
+
+/******************************************
+ * Delayed-acceptance Metropolis-Hastings (Christen & Fox):
+ *   Stage 1: accept y with min(1, pi_s(y)/pi_s(x)) using the surrogate pi_s (cheap)
+ *   Stage 2: survivors are accepted with min(1, pi(y)/pi(x) * pi_s(x)/pi_s(y)) using the full model pi
+ * The chain targets the full model posterior exactly, the full model only runs for stage 1 survivors.
+ * Surrogate posteriors are floored at DBL_MIN (still a valid stage 1), so a zero surrogate
+ * cannot stall the chain.
+ ******************************************/
+
+class DelayedAcceptance : public MCMC
+{
+private:
+	ForwardModel & fullmodel;	// Reference to a FULL forward model (stage 2), model is the surrogate (stage 1)
+	std::vector<double> sur_pos;	// Surrogate posterior of the current state of each local chain
+	std::vector<double> full_batch;	// Stage 1 survivors (structure-of-arrays) and their full posteriors
+	std::vector<double> full_pos;
+	std::vector<std::size_t> survivors;
+	// Statistics of the local chains
+	std::size_t num_proposals = 0;
+	std::size_t num_stage1 = 0;
+	std::size_t num_stage2 = 0;
+
+public:
+	~DelayedAcceptance() {}
+
+	DelayedAcceptance(
+			Config const& c,
+			Parallel & p,
+			ForwardModel & m,
+			ForwardModel & f) : MCMC(c, p, m), fullmodel(f) {}
+
+	void run(
+			std::size_t num_samples,
+			std::vector<double> const& init_samplepos = std::vector<double>()); // optional init vector
+
+private:
+	double one_step_delayed(std::size_t it);
+};
+#endif /* MCMC_DELAYEDACCEPTANCE_HPP_ */
@@ -27,142 +27,287 @@ MCMC::MCMC(
 		ForwardModel & m)
 		: cfg(c), par(p), model(m)
 {
-	num_chains = (size_t(par.size) < cfg.get_param_sizet("mcmc_max_chains")) ?
-			par.size : cfg.get_param_sizet("mcmc_max_chains");
+	num_local_chains = cfg.get_param_sizet("mcmc_chains_per_rank");
+	if (num_local_chains < 1) {
+		par.info();
+		printf("ERROR: mcmc_chains_per_rank must be at least 1. Program abort!\n");
+		exit(EXIT_FAILURE);
+	}
+	std::size_t max_chain_ranks = cfg.get_param_sizet("mcmc_max_chains") / num_local_chains;
+	if (max_chain_ranks < 1) max_chain_ranks = 1;
+	num_chain_ranks = (size_t(par.size) < max_chain_ranks) ? par.size : max_chain_ranks;
+	num_chains = num_chain_ranks * num_local_chains;
+
+	// Streams and outputs of the local chains
+	std::size_t input_size = cfg.get_input_size();
+	std::size_t chunk_size = cfg.get_param_sizet("mcmc_store_chunk_size");
+	rngs.reserve(num_local_chains);
+	for (std::size_t c=0; c < num_local_chains; c++) {
+		rngs.emplace_back(uint32_t(get_chain_id(c)));
+		stores.emplace_back(new SampleStore(input_size, chunk_size));
+	}
+	states.resize((input_size + 1) * num_local_chains);
+	proposals.resize(input_size * num_local_chains);
+	proposal_pos.resize(num_local_chains);
+	proposal_in.resize(num_local_chains);
+
+	string proposal = cfg.get_param_string("mcmc_proposal");
+	if (proposal != "randwalk" && proposal != "am") {
+		par.info();
+		printf("ERROR: unknown mcmc_proposal %s (randwalk|am). Program abort!\n", proposal.c_str());
+		exit(EXIT_FAILURE);
+	}
+	is_am = (proposal == "am");
 }
 
-double MCMC::one_step_single_dim(
-		std::size_t dim,	// IN: the dimension to be update in this step
-		vector<double> & samplepos, // IN/OUT: sample+posterior vector from last step (to be updated if proposal get accepted)
-		double inv_temp)
+double MCMC::one_step(
+		std::size_t it,
+		vector<double> const& inv_temps)
 {
-	/// NOTE: samplepos has length (input_size + 1), 
-	///       with last element being the posterior of the sample
-	/// Initialize proposal with the last sample
-	vector<double> proposal (samplepos);
-	proposal.pop_back(); /// sample only, remove posterior
+	/// NOTE: states has (input_size + 1) rows,
+	///       with last row being the posteriors of the local chains
+	std::size_t input_size = cfg.get_input_size();
+	std::size_t nc = num_local_chains;
 
+	// 1. Draw a proposal of each chain
+	propose(it);
+
+	// 2. Compute posteriors of all proposals at once
+	//    (all are evaluated, so every rank does the same # of model evaluations)
+	double tic = MPI_Wtime();
+	model.compute_posterior_batch(proposals, nc, &proposal_pos[0]);
+	double modeltime = MPI_Wtime() - tic;
+
+	// 3. Accept or reject proposals
+	double* pos = &states[input_size*nc];
+	for (std::size_t c=0; c < nc; c++) {
+		// For PT: i-th chain pi(x)_i = pi(x)^(1/T_i), posteriors are stored untempered
+		double inv_temp = inv_temps.empty() ? 1.0 : inv_temps[c];
+		double acc = proposal_in[c] ? fmin(1.0, pow(proposal_pos[c]/pos[c], inv_temp)) : 0.0;
+		if (rngs[c].uniform() <= acc) {
+			// Case accept: update sample and posterior
+			accept_proposal(c, proposal_pos[c]);
+		}// Case reject: do nothing
+		if (is_am) update_adaptation(c, acc);
+	}
+	if (is_am) end_adaptation_step();
+	return modeltime;
+}
+
+void MCMC::propose(std::size_t it)
+{
+	std::size_t input_size = cfg.get_input_size();
+	/// Initialize proposals with the last samples
+	std::copy(states.begin(), states.begin() + input_size*num_local_chains, proposals.begin());
+	std::fill(proposal_in.begin(), proposal_in.end(), 1);
+	for (std::size_t c=0; c < num_local_chains; c++) {
+		// Draws of this step are keyed by (seed, chain, step)
+		rngs[c].next_step();
+	}
+	if (is_am) {
+		propose_all_dims();
+	} else {
+		propose_single_dim(it % input_size);
+	}
+	return;
+}
+
+void MCMC::propose_single_dim(std::size_t dim)	// IN: the dimension to be update in this step
+{
+	std::size_t nc = num_local_chains;
 	// Compute random walk step = domain size * N  (N in [0.0, 0.1])
 	pair<double,double> range = model.get_input_space(dim);
 	double randwalk_size = (range.second - range.first) * cfg.get_param_double("mcmc_randwalk_step");
 
-	// Initialize random generators
-	mt19937 gen(chrono::system_clock::now().time_since_epoch().count());
-	normal_distribution<double> ndist(proposal[dim], randwalk_size);
-	uniform_real_distribution<double> udist(0.0,1.0);
+	// We only update proposal[dim]
+	double* sample_dim = &states[dim*nc];
+	double* proposal_dim = &proposals[dim*nc];
+	for (std::size_t c=0; c < nc; c++) {
+		proposal_dim[c] = rngs[c].normal(sample_dim[c], randwalk_size);
+		while ((proposal_dim[c] < range.first) || (proposal_dim[c] > range.second)) /// ensure p[dim] is in range
+			proposal_dim[c] = rngs[c].normal(sample_dim[c], randwalk_size);
+	}
+	return;
+}
 
-	// 1. Draw a proposal (we only update proposal[dim])
-	proposal[dim] = ndist(gen);
-	while ((proposal[dim] < range.first) || (proposal[dim] > range.second)) /// ensure p[dim] is in range
-		proposal[dim] = ndist(gen);
+void MCMC::propose_all_dims()
+{
+	std::size_t input_size = cfg.get_input_size();
+	std::size_t nc = num_local_chains;
+	// x + scale * L * z, z ~ N(0, I)
+	for (std::size_t c=0; c < nc; c++) {
+		rngs[c].normal(&am_z[0], input_size);
+		double scale = exp(am_log_scale[c]);
+		const double* L = &am_chol[c*input_size*input_size];
+		for (std::size_t i=0; i < input_size; i++) {
+			double v = 0.0;
+			for (std::size_t j=0; j <= i; j++)
+				v += L[i*input_size + j] * am_z[j];
+			proposals[i*nc + c] = states[i*nc + c] + scale * v;
+		}
+	}
+	// Proposals out of the domain are rejected (posterior 0)
+	for (std::size_t i=0; i < input_size; i++) {
+		pair<double,double> range = model.get_input_space(i);
+		for (std::size_t c=0; c < nc; c++) {
+			if ((proposals[i*nc + c] < range.first) || (proposals[i*nc + c] > range.second))
+				proposal_in[c] = 0;
+		}
+	}
+	return;
+}
 
-	// 2. Compute acceptance rate
-	double tic = MPI_Wtime();
-	vector<double> d = model.run(proposal);
-	double modeltime = MPI_Wtime() - tic;
+void MCMC::accept_proposal(std::size_t c, double pos)
+{
+	std::size_t input_size = cfg.get_input_size();
+	for (std::size_t i=0; i < input_size; i++)
+		states[i*num_local_chains + c] = proposals[i*num_local_chains + c];
+	states[input_size*num_local_chains + c] = pos;
+	return;
+}
 
-	double pos = cfg.compute_posterior(d);
-	pos = pow(pos, inv_temp); // For PT: i-th chain pi(x)_i = pi(x)^(1/T_i)
-	double acc = fmin(1.0, pos/samplepos.back());
+void MCMC::init_adaptation()
+{
+	std::size_t input_size = cfg.get_input_size();
+	std::size_t nc = num_local_chains;
+	am_mean.resize(input_size * nc);
+	am_chol.assign(input_size * input_size * nc, 0.0);
+	// Optimal scale for Gaussian targets: 2.38 / sqrt(d) (Roberts, Gelman & Gilks)
+	am_log_scale.assign(nc, log(2.38 / sqrt(double(input_size))));
+	am_count = 10.0 * input_size;
+	am_steps = 0;
+	am_z.resize(input_size);
+	for (std::size_t c=0; c < nc; c++) {
+		for (std::size_t i=0; i < input_size; i++) {
+			pair<double,double> range = model.get_input_space(i);
+			am_mean[c*input_size + i] = states[i*nc + c];
+			am_chol[(c*input_size + i)*input_size + i] =
+					(range.second - range.first) * cfg.get_param_double("mcmc_randwalk_step");
+		}
+	}
+	return;
+}
 
-	// 3. Accept or reject proposal
-	if (udist(gen) <= acc) {
-		// Case accept: update sample on dim and posterior
-		samplepos[dim] = proposal[dim];
-		samplepos.back() = pos;
-	}// Case reject: do nothing
-	return modeltime;
+void MCMC::update_adaptation(std::size_t c, double acc)
+{
+	std::size_t input_size = cfg.get_input_size();
+	std::size_t nc = num_local_chains;
+	// 1. Step scale: Robbins-Monro on log(scale) with diminishing gain
+	am_log_scale[c] += pow(am_steps + 1.0, -0.6) * (acc - cfg.get_param_double("mcmc_am_target_acc"));
+
+	// 2. Running mean and covariance with weight w of the new state x:
+	//    C' = (1-w) * (C + w*d*d^T), d = x - mean, i.e. L' = sqrt(1-w) * cholupdate(L, sqrt(w)*d)
+	double w = 1.0 / (am_count + 1.0);
+	double* mean = &am_mean[c*input_size];
+	double* L = &am_chol[c*input_size*input_size];
+	double sw = sqrt(w);
+	for (std::size_t i=0; i < input_size; i++) {
+		double d = states[i*nc + c] - mean[i];
+		mean[i] += w * d;
+		am_z[i] = sw * d;
+	}
+	// Rank-one update of the lower Cholesky factor, O(input_size^2)
+	for (std::size_t k=0; k < input_size; k++) {
+		double Lkk = L[k*input_size + k];
+		double r = sqrt(Lkk*Lkk + am_z[k]*am_z[k]);
+		double cs = r / Lkk;
+		double sn = am_z[k] / Lkk;
+		L[k*input_size + k] = r;
+		for (std::size_t i=k+1; i < input_size; i++) {
+			L[i*input_size + k] = (L[i*input_size + k] + sn * am_z[i]) / cs;
+			am_z[i] = cs * am_z[i] - sn * L[i*input_size + k];
+		}
+	}
+	double shrink = sqrt(1.0 - w);
+	for (std::size_t i=0; i < input_size; i++)
+		for (std::size_t j=0; j <= i; j++)
+			L[i*input_size + j] *= shrink;
+	return;
 }
 
-// The read from file the sample+posterior vector with the maximum posterior
-// This is a line (usually the last line) in format: "MAXPOS 0.1 0.2 0.3 0.4 ..."
-vector<double> MCMC::read_max_samplepos(fstream& fin)
+vector<double> MCMC::get_samplepos(std::size_t c) const
+{
+	vector<double> samplepos (cfg.get_input_size() + 1);
+	for (std::size_t d=0; d < samplepos.size(); d++)
+		samplepos[d] = states[d*num_local_chains + c];
+	return samplepos;
+}
+
+void MCMC::set_samplepos(
+		std::size_t c,
+		vector<double> const& samplepos)
+{
+	for (std::size_t d=0; d <= cfg.get_input_size(); d++)
+		states[d*num_local_chains + c] = samplepos[d];
+	return;
+}
+
+// Read the sample+posterior vector with the maximum posterior from the footer of a sample file
+vector<double> MCMC::read_max_samplepos(string const& fname)
 {
 	/// Note: samplepos is a vector of length (input_size + 1),
 	///		with the first (input_size) elements being the sample,
 	///		and the last element being the posterior
-	vector<double> samplepos (cfg.get_input_size() + 1);
+	vector<double> samplepos = SampleStore::read_maxpos(fname);
+	// If not found (or of another dimension), return samplepos as an empty vector
+	if (samplepos.size() != cfg.get_input_size() + 1)
+		samplepos.clear();
+	return samplepos;
+}
 
-	/// NOTE: Considering the mcmc output file would be large and the MAXPOS line being the last line,
-	/// 	we loop from the bottom of file backwards.
-	fin.seekg(0, fin.end);
-	std::size_t len = fin.tellg(); // Get length of file
-	// Loop backwards
-	char c;
-	string line;
-	for (long int i=len-2; i > 0; i--) {
-		fin.seekg(i);
-		c = fin.get();
-		if (c == '\r' || c == '\n') {
-			std::getline(fin, line);
-			istringstream iss(line);
-			vector<string> tokens {istream_iterator<string>{iss}, istream_iterator<string>{}};
-			if ((tokens.size() > samplepos.size()) && (tokens[0] == "MAXPOS")) { //This is the line we are looking for
-				// Read in data
-				for (int k=0; k < samplepos.size(); k++) {
-					samplepos[k] = stod(tokens[k+1]);
-				}
-				fin.seekg(0, fin.end);
-				return samplepos; // If found, return immediately
-			}
-		}
-	} //end for
-	fin.seekg(0, fin.end);
-	// If not found, return samplepos as an empty vector
-	samplepos.clear();
-	return samplepos; 
+string MCMC::get_output_fname(std::size_t c)
+{
+	return cfg.get_param_string("global_output_path") +
+			"/mcmc_c" + std::to_string(get_chain_id(c)) + "_samplepos.bin";
 }
 
-fstream MCMC::open_output_file()
+void MCMC::open_output_file(std::size_t c, double temperature)
 {
-	// Initialize rank specific output file
-	string rank_output_file = cfg.get_param_string("global_output_path") +
-			"/mcmc_r" + std::to_string(par.rank) + "_samplepos.txt";
-	// Open file:
-	//fstream fout (rank_output_file, fstream::out | fstream::app); // Append if file exists
-	fstream fout (rank_output_file, fstream::out | ios::trunc); // Overwrite if file exists
-	if (!fout) {
+	// Initialize chain specific output file (overwrite if file exists)
+	string chain_output_file = get_output_fname(c);
+	if (!stores[c]->open(chain_output_file, uint32_t(get_chain_id(c)), temperature)) {
 		par.info();
-		printf("ERROR: MCMC open output file %s failed. Program abort!\n", rank_output_file.c_str());
+		printf("ERROR: MCMC open output file %s failed. Program abort!\n", chain_output_file.c_str());
 		exit(EXIT_FAILURE);
 	}
-	return fout;
+	return;
 }
 
-void MCMC::write_samplepos(
-		fstream& fout,
-		vector<double> const& samplepos)
+void MCMC::close_output_file(std::size_t c)
 {
-	for (size_t i=0; i < samplepos.size()-1; ++i) {
-		fout << samplepos[i] << " ";
+	if (!stores[c]->close()) {
+		par.info();
+		printf("ERROR: MCMC write output file %s failed. Program abort!\n", get_output_fname(c).c_str());
+		exit(EXIT_FAILURE);
 	}
-	fout << samplepos.back() << endl;
 	return;
 }
 
-vector<double> MCMC::initialize_samplepos(
+void MCMC::initialize_samplepos(
 		vector<double> const& init_samplepos)
 {	
-	// Samplepos is a vector of sample + posterior (length = input_size + 1)
+	// Each chain has a sample + posterior (length = input_size + 1)
 	std::size_t input_size = cfg.get_input_size();
-	vector<double> samplepos (input_size + 1);
-
-	// Rank 0 use the init_samplepos if provided
-	if (par.is_master() && init_samplepos.size() == samplepos.size()) {
-		samplepos = init_samplepos;
-	} else {
-	// Or generate a random one
-		mt19937 gen (chrono::system_clock::now().time_since_epoch().count());
-		for (size_t i=0; i < input_size; i++) {
-			pair<double,double> range = model.get_input_space(i);
-			uniform_real_distribution<double> udist(range.first, range.second);
-			samplepos[i] = udist(gen);
+	std::size_t nc = num_local_chains;
+	for (std::size_t c=0; c < nc; c++) {
+		// Chain 0 use the init_samplepos if provided
+		if (get_chain_id(c) == 0 && init_samplepos.size() == input_size + 1) {
+			set_samplepos(c, init_samplepos);
+		} else {
+		// Or generate a random one (step 0 of the chain's stream)
+			rngs[c].set_step(0);
+			for (size_t i=0; i < input_size; i++) {
+				pair<double,double> range = model.get_input_space(i);
+				states[i*nc + c] = rngs[c].uniform(range.first, range.second);
+			}
 		}
-		samplepos.pop_back(); // To make it exact input_size for now
-		vector<double> d = model.run(samplepos);
-		samplepos.push_back( cfg.compute_posterior(d) ); // put posterior to end
 	}
-	return samplepos;
+	// Posterior is always (re)computed, so all chains do the same # of model evaluations
+	// (required by collective model evaluation, e.g. distributed SGI)
+	model.compute_posterior_batch(states, nc, &proposal_pos[0]);
+	std::copy(proposal_pos.begin(), proposal_pos.end(), states.begin() + input_size*nc);
+	if (is_am) init_adaptation();
+	return;
 }
 
 void MCMC::print_progress(int iter, double acc_modeltime, vector<double> const& max_samplepos)
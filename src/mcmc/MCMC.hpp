@@ -22,6 +22,8 @@
 #include <model/ForwardModel.hpp>
 #include <tools/Parallel.hpp>
 #include <tools/Config.hpp>
+#include <tools/RandomStream.hpp>
+#include <mcmc/SampleStore.hpp>
 
 #include <mpi.h>
 #include <vector>
@@ -30,16 +32,16 @@
 #include <fstream>
 #include <sstream>
 #include <iterator>
-#include <random>
-#include <chrono>
 #include <cmath>
 
 /******************************************
- * MCMC solver writes output data into a text file.
+ * MCMC solver writes output data into a binary file per chain (see SampleStore).
  * 	 - Data type: double
- * 	 - Each line consists of a sample_point & its posterior
+ * 	 - Each record consists of a sample_point & its posterior
  * 	 - A sample_point is double[input_size]
- * 	 - Therfore, each line has (input_size + 1) number of data
+ * 	 - Therfore, each record has (input_size + 1) number of data
+ * 	 - The footer holds MAXPOS, mean and variance of the chain
+ * Each rank advances a block of chains, whose proposals are evaluated together.
  ******************************************/
 
 class MCMC {
@@ -47,9 +49,34 @@ protected:
 	Config const& cfg;		// Const reference to config object
 	Parallel & par;			// Reference to parallel object
 	ForwardModel & model;	// Reference to foward model object
-	// Number of parallel MCMC chains = min(mpisize, max_chains).
-	// Only ranks with (mpirank < num_chains) participate in MCMC computation, others idle
+	// Number of parallel MCMC chains = num_chain_ranks * num_local_chains.
+	// Only ranks with (mpirank < num_chain_ranks) participate in MCMC computation, others idle
 	std::size_t num_chains;
+	std::size_t num_chain_ranks;
+	// Chains advanced together by each rank (mcmc_chains_per_rank),
+	// local chain c of this rank is global chain (rank * num_local_chains + c)
+	std::size_t num_local_chains;
+	// States of the local chains as structure-of-arrays: (input_size + 1)-by-num_local_chains, row-major,
+	// i.e. dimension d of chain c at [d*num_local_chains + c], the last row holds the posteriors
+	std::vector<double> states;
+	// Proposals of one step (input_size rows of states) and their posteriors
+	std::vector<double> proposals;
+	std::vector<double> proposal_pos;
+	std::vector<char> proposal_in;	// proposal is in the input space (otherwise rejected)
+	// Random stream of each local chain (stream = global chain id), each MCMC step uses its own counter block
+	std::vector<RandomStream> rngs;
+	// Sample output of each local chain, written by a background thread
+	std::vector< std::unique_ptr<SampleStore> > stores;
+	// Adaptive Metropolis (mcmc_proposal = am), per local chain: running mean (input_size),
+	// lower Cholesky factor of the running covariance (input_size-by-input_size, row-major)
+	// and log of the step scale. Initial covariance is the random walk step in each dimension.
+	bool is_am;
+	std::vector<double> am_mean;
+	std::vector<double> am_chol;
+	std::vector<double> am_log_scale;
+	double am_count;		// weight of the running covariance (initial covariance counts as 10*input_size samples)
+	std::size_t am_steps;	// adaptive steps done
+	std::vector<double> am_z;	// buffer
 
 public:
 	virtual ~MCMC() {}
@@ -64,21 +91,54 @@ public:
 			std::vector<double> const& init_samplepos = std::vector<double>()) = 0;
 
 protected:
-	double one_step_single_dim(
-			std::size_t dim,
-			std::vector<double> & samplepos,
-			double inv_temp = 1.0); // The optional parameter is for PT only.
-									// Others (e.g. MH) can call the single step without the temperature.
+	// MCMC step it of all local chains, proposals are evaluated with one batched model call
+	double one_step(
+			std::size_t it,
+			std::vector<double> const& inv_temps = std::vector<double>()); // The optional parameter is for PT only
+									// (inverse temperature of each local chain).
 
-	std::vector<double> read_max_samplepos(std::fstream& fin);
+	// Proposals of step it for all local chains: random walk in dimension (it % input_size),
+	// or adaptive Metropolis in all dimensions
+	void propose(std::size_t it);
 
-	std::fstream open_output_file();
+	void propose_single_dim(std::size_t dim);
 
-	void write_samplepos(
-			std::fstream& fout,
+	void propose_all_dims();
+
+	// Accept the proposal of local chain c with posterior pos
+	void accept_proposal(std::size_t c, double pos);
+
+	void init_adaptation();
+
+	// Step scale towards the target acceptance rate, rank-one update of mean and Cholesky factor
+	void update_adaptation(std::size_t c, double acc);
+
+	void end_adaptation_step() {am_count += 1.0; am_steps++;}
+
+	std::size_t get_chain_id(std::size_t c) const {return par.rank * num_local_chains + c;}
+
+	double& get_pos(std::size_t c) {return states[cfg.get_input_size() * num_local_chains + c];}
+
+	// Sample + posterior of local chain c
+	std::vector<double> get_samplepos(std::size_t c) const;
+
+	// Uses the first (input_size + 1) elements of samplepos
+	void set_samplepos(
+			std::size_t c,
 			std::vector<double> const& samplepos);
 
-	std::vector<double> initialize_samplepos(
+	std::vector<double> read_max_samplepos(std::string const& fname);
+
+	std::string get_output_fname(std::size_t c);
+
+	void open_output_file(std::size_t c, double temperature = 1.0);
+
+	void write_samplepos(std::size_t c) {stores[c]->write(&states[c], num_local_chains);}
+
+	void close_output_file(std::size_t c);
+
+	// Starting points of all local chains (global chain 0 uses init_samplepos if provided)
+	void initialize_samplepos(
 			std::vector<double> const& init_samplepos = std::vector<double>()); // optional argument
 
 	void print_progress(int iter, double acc_modeltime, std::vector<double> const& max_samplepos);
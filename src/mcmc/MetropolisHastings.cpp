@@ -25,46 +25,48 @@ void MetropolisHastings::run(
 			std::size_t num_samples,
 			std::vector<double> const& init_samplepos)
 {
-	// Each MCMC chain is pinned to a MPI process
-	// Ranks with (mpirank > num_chains) do NOT participate in MCMC computation
-	if (par.rank >= num_chains) return;
+	// Each rank advances a block of MCMC chains
+	// Ranks with (mpirank >= num_chain_ranks) do NOT participate in MCMC computation
+	if (par.rank >= num_chain_ranks) return;
 
-	// Output file
-	fstream fout = open_output_file();
+	// Output files
+	for (size_t c=0; c < num_local_chains; c++)
+		open_output_file(c);
 	
-	// Initialize starting point & maxpos point
-	std::size_t input_size = cfg.get_input_size();
-	vector<double> samplepos = initialize_samplepos(init_samplepos);
-	vector<double> max_samplepos = samplepos;
-	// Write initial MCMC sample
-	write_samplepos(fout, samplepos);
+	// Initialize starting points & maxpos points
+	initialize_samplepos(init_samplepos);
+	vector< vector<double> > max_samplepos (num_local_chains);
+	for (size_t c=0; c < num_local_chains; c++) {
+		max_samplepos[c] = get_samplepos(c);
+		// Write initial MCMC sample
+		write_samplepos(c);
+	}
 
-	// Run the MCMC chain
-	int dim = 0;
+	// Run the MCMC chains
 	double acc_modeltime = 0.0;
 	for (int it=0; it < num_samples; ++it) {
-		// 1. Perform 1 MCMC step
-		dim = it%input_size;
-		acc_modeltime += one_step_single_dim(dim, samplepos);
+		// 1. Perform 1 MCMC step of all local chains
+		acc_modeltime += one_step(it);
 
-		// 2. write result
-		write_samplepos(fout, samplepos);
+		for (size_t c=0; c < num_local_chains; c++) {
+			// 2. write result
+			write_samplepos(c);
 
-		// 3. Get max posterior and the corresponding sample point
-		if (samplepos.back() > max_samplepos.back()) {
-			max_samplepos = samplepos;
+			// 3. Get max posterior and the corresponding sample point
+			if (get_pos(c) > max_samplepos[c].back()) {
+				max_samplepos[c] = get_samplepos(c);
+			}
 		}
 		// 4. keeping track
 #if (MCMC_PRINT_PROGRESS == 1)
 		if (par.is_master() && (it+1) % stoi(cfg.get_param_string("mcmc_progress_freq_step")) == 0) {
-			print_progress(it+1, acc_modeltime, max_samplepos);
+			print_progress(it+1, acc_modeltime, max_samplepos[0]);
 		}
 #endif
 	}
-	// Insert MAXPOS point to file
-	fout << "MAXPOS ";
-	write_samplepos(fout, max_samplepos);
-	fout.close();
+	// MAXPOS is written to the footer on close
+	for (size_t c=0; c < num_local_chains; c++)
+		close_output_file(c);
 	return;
 }
 
@@ -0,0 +1,331 @@
+// eBayes - Elastic Bayesian Inference Framework with iMPI
+// Copyright (C) 2015-today Ao Mo-Hellenbrand
+//
+// All copyrights remain with the respective authors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <mcmc/MultilevelMCMC.hpp>
+
+using namespace std;
+
+
+MultilevelMCMC::MultilevelMCMC(
+		Config const& c,
+		Parallel & p,
+		ForwardModel & m)
+		: MCMC(c, p, m)
+{
+	// Coarse levels halve the resolution multipliers, which must stay integers
+	num_levels = cfg.get_param_sizet("mcmc_ml_levels");
+	std::size_t coarsen = (num_levels > 0) ? (std::size_t(1) << (num_levels - 1)) : 0;
+	if (num_levels < 1 || cfg.get_param_sizet("ns_resx") % coarsen != 0
+			|| cfg.get_param_sizet("ns_resy") % coarsen != 0) {
+		par.info();
+		printf("ERROR: mcmc_ml_levels %lu needs ns_resx and ns_resy divisible by 2^(mcmc_ml_levels-1). Program abort!\n",
+				num_levels);
+		exit(EXIT_FAILURE);
+	}
+	for (std::size_t l=0; l+1 < num_levels; l++) {
+		coarse_models.emplace_back(new NS(cfg, std::size_t(1) << (num_levels - 1 - l)));
+		levels.push_back(coarse_models.back().get());
+	}
+	levels.push_back(&model);
+
+	std::size_t input_size = cfg.get_input_size();
+	std::size_t chunk_size = cfg.get_param_sizet("mcmc_store_chunk_size");
+	level_states.resize(num_levels);
+	level_coarse_pos.resize(num_levels);
+	level_chains.resize(num_levels);
+	level_stores.resize(num_levels);
+	for (std::size_t l=0; l < num_levels; l++) {
+		level_coarse_pos[l].resize(num_local_chains);
+		for (std::size_t c=0; c < num_local_chains; c++)
+			level_stores[l].emplace_back(new SampleStore(input_size, chunk_size));
+	}
+}
+
+void MultilevelMCMC::run(
+			std::size_t num_samples,
+			std::vector<double> const& init_samplepos)
+{
+	// Ranks with (mpirank >= num_chain_ranks) do NOT advance chains,
+	// but take part in the reductions of the level statistics
+	bool is_chain_rank = (size_t(par.rank) < num_chain_ranks);
+	double tic = MPI_Wtime();
+	num_pilot = std::min(cfg.get_param_sizet("mcmc_ml_pilot_samples"), num_samples);
+	num_level_samples.assign(num_levels, num_pilot);
+	level_strides.assign(num_levels, 1);
+	stats.assign(num_levels * get_stats_size(), 0.0);
+
+	// 1. Pilot samples of all levels
+	if (is_chain_rank) {
+		initialize_levels(init_samplepos);
+		for (std::size_t l=0; l < num_levels; l++)
+			run_level(l, 0, num_pilot);
+	}
+	// 2. Samples per level from the pilot variances and costs
+	allocate_samples(num_samples);
+
+	// 3. Remaining samples, coarse to fine
+	if (is_chain_rank) {
+		for (std::size_t l=0; l < num_levels; l++)
+			run_level(l, num_pilot, num_level_samples[l]);
+		for (std::size_t l=0; l < num_levels; l++) {
+			for (std::size_t c=0; c < num_local_chains; c++) {
+				if (!level_stores[l][c]->close()) {
+					par.info();
+					printf("ERROR: MCMC write output file %s failed. Program abort!\n", get_level_fname(l, c).c_str());
+					exit(EXIT_FAILURE);
+				}
+			}
+		}
+	}
+
+	// 4. Telescoping sum of the level means
+	vector<double> s = reduce_stats();
+	if (par.is_master()) {
+		std::size_t input_size = cfg.get_input_size();
+		std::size_t len = get_stats_size();
+		vector<double> mean (input_size, 0.0);
+		double time = 0.0;
+		for (std::size_t l=0; l < num_levels; l++) {
+			vector<double> ymean (input_size);
+			for (std::size_t d=0; d < input_size; d++) {
+				ymean[d] = s[l*len + d] / s[l*len + 2*input_size];
+				mean[d] += ymean[d];
+			}
+			time += s[l*len + 2*input_size + 1];
+			par.info();
+			printf("MCMCML: level %lu | resolution 1/%lu | samples %lu | E[Y] %s | var %.3e | cost/sample(sec) %.6f\n",
+					l, std::size_t(1) << (num_levels - 1 - l), num_level_samples[l],
+					tools::sample_to_string(ymean).c_str(), get_variance(s, l), get_cost(s, l));
+		}
+		// Same # of samples on the finest level alone
+		double single = s[2*input_size] * get_cost(s, num_levels - 1);
+		par.info();
+		printf("MCMCML: posterior mean %s | model time %.2f%% of single-level sampling | wall.time(sec) %.6f\n",
+				tools::sample_to_string(mean).c_str(), 100.0 * time / single, MPI_Wtime() - tic);
+	}
+	return;
+}
+
+string MultilevelMCMC::get_level_fname(std::size_t l, std::size_t c)
+{
+	return cfg.get_param_string("global_output_path") + "/mcmc_c" + std::to_string(get_chain_id(c)) +
+			"_l" + std::to_string(l) + "_samplepos.bin";
+}
+
+void MultilevelMCMC::initialize_levels(vector<double> const& init_samplepos)
+{
+	std::size_t input_size = cfg.get_input_size();
+	std::size_t nc = num_local_chains;
+	for (std::size_t l=0; l < num_levels; l++) {
+		for (std::size_t c=0; c < nc; c++) {
+			string fname = get_level_fname(l, c);
+			if (!level_stores[l][c]->open(fname, uint32_t(get_chain_id(c)))) {
+				par.info();
+				printf("ERROR: MCMC open output file %s failed. Program abort!\n", fname.c_str());
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+	// All levels start from the same points, posteriors are computed on each level
+	// (initialize_samplepos evaluates model, i.e. the finest level)
+	initialize_samplepos(init_samplepos);
+	for (std::size_t l=num_levels; l-- > 0;) {
+		level_states[l] = states;
+		double* pos = &level_states[l][input_size*nc];
+		if (l+1 < num_levels)
+			levels[l]->compute_posterior_batch(states, nc, pos);
+		for (std::size_t c=0; c < nc; c++) {
+			pos[c] = fmax(pos[c], DBL_MIN);
+			if (l+1 < num_levels) level_coarse_pos[l+1][c] = pos[c];
+		}
+		for (std::size_t c=0; c < nc; c++) {
+			level_stores[l][c]->write(&level_states[l][c], nc);
+			if (l+1 < num_levels)
+				for (std::size_t d=0; d <= input_size; d++)
+					level_chains[l].push_back(level_states[l][d*nc + c]);
+		}
+	}
+	return;
+}
+
+void MultilevelMCMC::run_level(std::size_t l, std::size_t begin, std::size_t end)
+{
+	std::size_t input_size = cfg.get_input_size();
+	std::size_t nc = num_local_chains;
+	double* s = &stats[l * get_stats_size()];
+	states.swap(level_states[l]);
+	for (std::size_t it=begin; it < end; it++) {
+		// 1. Perform 1 MCMC step of all local chains
+		double modeltime = (l == 0) ? one_step_coarsest(it) : one_step_level(l, it);
+
+		for (std::size_t c=0; c < nc; c++) {
+			// 2. write result, keep the chain for the next finer level
+			level_stores[l][c]->write(&states[c], nc);
+			if (l+1 < num_levels)
+				for (std::size_t d=0; d <= input_size; d++)
+					level_chains[l].push_back(states[d*nc + c]);
+
+			// 3. Y_l = sample - coarse proposal (level 0: the sample)
+			for (std::size_t d=0; d < input_size; d++) {
+				double y = states[d*nc + c] - ((l > 0) ? proposals[d*nc + c] : 0.0);
+				s[d] += y;
+				s[input_size + d] += y*y;
+			}
+		}
+		s[2*input_size] += nc;
+		s[2*input_size + 1] += modeltime;
+	}
+	states.swap(level_states[l]);
+	return;
+}
+
+double MultilevelMCMC::one_step_coarsest(std::size_t it)
+{
+	std::size_t input_size = cfg.get_input_size();
+	std::size_t nc = num_local_chains;
+
+	// 1. Draw a proposal of each chain (mcmc_proposal)
+	propose(it);
+
+	// 2. Posteriors of the proposals in the input space on the coarsest level
+	//    (NS cannot place obstacles outside the domain)
+	inside.clear();
+	for (std::size_t c=0; c < nc; c++)
+		if (proposal_in[c]) inside.push_back(c);
+	std::size_t ni = inside.size();
+	double tic = MPI_Wtime();
+	if (ni > 0) {
+		batch.resize(input_size * ni);
+		batch_pos.resize(ni);
+		for (std::size_t i=0; i < input_size; i++)
+			for (std::size_t k=0; k < ni; k++)
+				batch[i*ni + k] = proposals[i*nc + inside[k]];
+		levels[0]->compute_posterior_batch(batch, ni, &batch_pos[0]);
+	}
+	double modeltime = MPI_Wtime() - tic;
+	for (std::size_t k=0; k < ni; k++)
+		proposal_pos[inside[k]] = fmax(batch_pos[k], DBL_MIN);
+
+	// 3. Accept or reject proposals
+	double* pos = &states[input_size*nc];
+	for (std::size_t c=0; c < nc; c++) {
+		double acc = proposal_in[c] ? fmin(1.0, proposal_pos[c]/pos[c]) : 0.0;
+		if (rngs[c].uniform() <= acc) {
+			accept_proposal(c, proposal_pos[c]);
+		}
+		if (is_am) update_adaptation(c, acc);
+	}
+	if (is_am) end_adaptation_step();
+	return modeltime;
+}
+
+double MultilevelMCMC::one_step_level(std::size_t l, std::size_t it)
+{
+	std::size_t input_size = cfg.get_input_size();
+	std::size_t nc = num_local_chains;
+
+	// 1. Proposals are the next records of the level l-1 chains
+	const double* rec = &level_chains[l-1][get_coarse_record(l, it) * nc * (input_size+1)];
+	for (std::size_t c=0; c < nc; c++) {
+		rngs[c].next_step();
+		for (std::size_t d=0; d < input_size; d++)
+			proposals[d*nc + c] = rec[c*(input_size+1) + d];
+	}
+
+	// 2. Posteriors of all proposals on level l
+	double tic = MPI_Wtime();
+	levels[l]->compute_posterior_batch(proposals, nc, &proposal_pos[0]);
+	double modeltime = MPI_Wtime() - tic;
+
+	// 3. Accept or reject proposals, the coarse posterior ratio of the proposal is divided out
+	double* pos = &states[input_size*nc];
+	double* coarse_pos = &level_coarse_pos[l][0];
+	for (std::size_t c=0; c < nc; c++) {
+		double prop_coarse_pos = rec[c*(input_size+1) + input_size];
+		proposal_pos[c] = fmax(proposal_pos[c], DBL_MIN);
+		double acc = fmin(1.0, (proposal_pos[c]/pos[c]) * (coarse_pos[c]/prop_coarse_pos));
+		if (rngs[c].uniform() <= acc) {
+			accept_proposal(c, proposal_pos[c]);
+			coarse_pos[c] = prop_coarse_pos;
+		}
+	}
+	return modeltime;
+}
+
+std::size_t MultilevelMCMC::get_coarse_record(std::size_t l, std::size_t it) const
+{
+	// Pilot steps take consecutive records (record 0 is the starting point),
+	// later steps spread over the rest of the coarser chain
+	if (it < num_pilot) return it + 1;
+	return num_pilot + 1 + (it - num_pilot) * level_strides[l];
+}
+
+void MultilevelMCMC::allocate_samples(std::size_t num_samples)
+{
+	// Minimal total variance sum(V_l/N_l) for a given cost sum(N_l*C_l): N_l ~ sqrt(V_l/C_l).
+	// Each coarse sample is proposed at most once, so N_l <= N_{l-1}.
+	vector<double> s = reduce_stats();
+	num_level_samples[0] = num_samples;
+	double v0 = get_variance(s, 0);
+	double c0 = get_cost(s, 0);
+	for (std::size_t l=1; l < num_levels; l++) {
+		double vl = get_variance(s, l);
+		double cl = get_cost(s, l);
+		double ratio = (v0 > 0.0 && cl > 0.0) ? sqrt((vl * c0) / (v0 * cl)) : 1.0;
+		std::size_t n = std::size_t(ceil(num_samples * ratio));
+		num_level_samples[l] = std::min(num_level_samples[l-1], std::max(num_pilot, n));
+		if (num_level_samples[l] > num_pilot) {
+			level_strides[l] = std::max(std::size_t(1),
+					(num_level_samples[l-1] - num_pilot) / (num_level_samples[l] - num_pilot));
+		}
+	}
+	if (par.is_master()) {
+		for (std::size_t l=0; l < num_levels; l++) {
+			par.info();
+			printf("MCMCML: level %lu | pilot var %.3e | cost/sample(sec) %.6f | samples %lu | proposal stride %lu\n",
+					l, get_variance(s, l), get_cost(s, l), num_level_samples[l], level_strides[l]);
+		}
+	}
+	return;
+}
+
+vector<double> MultilevelMCMC::reduce_stats()
+{
+	vector<double> s (stats.size());
+	MPI_Allreduce(&stats[0], &s[0], int(stats.size()), MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+	return s;
+}
+
+double MultilevelMCMC::get_variance(vector<double> const& s, std::size_t l) const
+{
+	std::size_t input_size = cfg.get_input_size();
+	const double* sl = &s[l * get_stats_size()];
+	double n = sl[2*input_size];
+	if (n < 2.0) return 0.0;
+	double var = 0.0;
+	for (std::size_t d=0; d < input_size; d++)
+		var += (sl[input_size + d] - sl[d]*sl[d]/n) / (n - 1.0);
+	return var;
+}
+
+double MultilevelMCMC::get_cost(vector<double> const& s, std::size_t l) const
+{
+	const double* sl = &s[l * get_stats_size()];
+	double n = sl[2*cfg.get_input_size()];
+	return (n > 0.0) ? sl[2*cfg.get_input_size() + 1] / n : 0.0;
+}
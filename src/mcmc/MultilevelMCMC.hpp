@@ -0,0 +1,114 @@
+// eBayes - Elastic Bayesian Inference Framework with iMPI
+// Copyright (C) 2015-today Ao Mo-Hellenbrand
+//
+// All copyrights remain with the respective authors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MCMC_MULTILEVELMCMC_HPP_
+#define MCMC_MULTILEVELMCMC_HPP_
+
+#include <mcmc/MCMC.hpp>
+#include <mcmc/SampleStore.hpp>
+#include <tools/Config.hpp>
+#include <tools/Parallel.hpp>
+#include <model/ForwardModel.hpp>
+#include <model/NS.hpp>
+
+#include <mpi.h>
+#include <cmath>
+#include <cfloat>
+#include <string>
+#include <vector>
+#include <memory>
+
+/******************************************
+ * Multilevel MCMC (Dodwell, Ketelsen, Scheichl & Teckentrup) over NS resolutions:
+ *   Level l uses NS with resolution (ns_resx, ns_resy) / 2^(L-1-l), level L-1 is the given (finest) model.
+ *   Level 0 is a Metropolis-Hastings chain (mcmc_proposal) on the coarsest model pi_0.
+ *   Level l > 0 proposes samples of the level l-1 chain (thinned) and accepts them with
+ *   min(1, pi_l(y)/pi_l(x) * pi_{l-1}(x)/pi_{l-1}(y)), i.e. the chain targets pi_l.
+ * Posterior mean of the sample on the finest level (telescoping sum):
+ *   E_{L-1}[x] = E_0[x] + sum_l E[Y_l], Y_l = x_l - (coarse proposal of the same step)
+ * Samples per level N_l = N_0 * sqrt(V_l/C_l * C_0/V_0) (variance V_l of Y_l and cost C_l per sample
+ * from pilot runs of all chains), N_0 = mcmc_num_samples, N_l <= N_{l-1}.
+ * Each chain writes one sample file per level, posteriors are floored at DBL_MIN.
+ ******************************************/
+
+class MultilevelMCMC : public MCMC
+{
+private:
+	std::size_t num_levels;
+	std::vector< std::unique_ptr<NS> > coarse_models;	// Levels 0 .. num_levels-2
+	std::vector<ForwardModel*> levels;		// Model of each level, the last one is model
+	// Per level: states of the local chains (same layout as states), posteriors of the current
+	// states on the next coarser level, and the chain so far (records of input_size + 1, step-major,
+	// only kept for proposals of the next finer level)
+	std::vector< std::vector<double> > level_states;
+	std::vector< std::vector<double> > level_coarse_pos;
+	std::vector< std::vector<double> > level_chains;
+	std::vector< std::vector< std::unique_ptr<SampleStore> > > level_stores;
+	// Samples of each level (pilot samples included) and stride of its proposals in the coarser chain
+	std::size_t num_pilot;
+	std::vector<std::size_t> num_level_samples;
+	std::vector<std::size_t> level_strides;
+	// Statistics of the local chains per level: sum (input_size) and sum of squares (input_size)
+	// of Y_l, # of samples and model time, reduced over all ranks
+	std::vector<double> stats;
+	// Proposals of the coarsest level inside the input space (structure-of-arrays) and their posteriors
+	std::vector<std::size_t> inside;
+	std::vector<double> batch;
+	std::vector<double> batch_pos;
+
+public:
+	~MultilevelMCMC() {}
+
+	MultilevelMCMC(
+			Config const& c,
+			Parallel & p,
+			ForwardModel & m);	// model on the finest level
+
+	void run(
+			std::size_t num_samples,
+			std::vector<double> const& init_samplepos = std::vector<double>()); // optional init vector
+
+private:
+	std::size_t get_stats_size() const {return 2 * cfg.get_input_size() + 2;}
+
+	std::string get_level_fname(std::size_t l, std::size_t c);
+
+	// Starting point of all levels, record 0 of all level chains
+	void initialize_levels(std::vector<double> const& init_samplepos);
+
+	// Steps [begin, end) of the level l chains
+	void run_level(std::size_t l, std::size_t begin, std::size_t end);
+
+	double one_step_coarsest(std::size_t it);
+
+	double one_step_level(std::size_t l, std::size_t it);
+
+	// Record of the level l-1 chain proposed in step it of level l
+	std::size_t get_coarse_record(std::size_t l, std::size_t it) const;
+
+	// Samples of each level from the pilot statistics
+	void allocate_samples(std::size_t num_samples);
+
+	// Statistics of all chains, and the variance (sum over dimensions) and cost per sample of level l
+	std::vector<double> reduce_stats();
+
+	double get_variance(std::vector<double> const& s, std::size_t l) const;
+
+	double get_cost(std::vector<double> const& s, std::size_t l) const;
+};
+#endif /* MCMC_MULTILEVELMCMC_HPP_ */
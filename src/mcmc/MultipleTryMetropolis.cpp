@@ -0,0 +1,204 @@
+// eBayes - Elastic Bayesian Inference Framework with iMPI
+// Copyright (C) 2015-today Ao Mo-Hellenbrand
+//
+// All copyrights remain with the respective authors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <mcmc/MultipleTryMetropolis.hpp>
+
+using namespace std;
+
+
+MultipleTryMetropolis::MultipleTryMetropolis(
+		Config const& c,
+		Parallel & p,
+		ForwardModel & m)
+		: MCMC(c, p, m)
+{
+	num_tries = cfg.get_param_sizet("mcmc_mtm_tries");
+	if (num_tries < 1) {
+		par.info();
+		printf("ERROR: mcmc_mtm_tries must be at least 1. Program abort!\n");
+		exit(EXIT_FAILURE);
+	}
+	std::size_t input_size = cfg.get_input_size();
+	for (std::size_t i=0; i < input_size; i++)
+		ranges.push_back(model.get_input_space(i));
+	tries.resize(input_size * num_local_chains * num_tries);
+	try_pos.resize(num_local_chains * num_tries);
+	refs.resize(input_size * num_local_chains * (num_tries - 1));
+	ref_pos.resize(num_local_chains * (num_tries - 1));
+	selected.resize(num_local_chains);
+}
+
+void MultipleTryMetropolis::run(
+			std::size_t num_samples,
+			std::vector<double> const& init_samplepos)
+{
+	// Each rank advances a block of MCMC chains
+	// Ranks with (mpirank >= num_chain_ranks) do NOT participate in MCMC computation
+	if (par.rank >= num_chain_ranks) return;
+
+	// Output files
+	for (size_t c=0; c < num_local_chains; c++)
+		open_output_file(c);
+
+	// Initialize starting points & maxpos points
+	initialize_samplepos(init_samplepos);
+	vector< vector<double> > max_samplepos (num_local_chains);
+	for (size_t c=0; c < num_local_chains; c++) {
+		max_samplepos[c] = get_samplepos(c);
+		// Write initial MCMC sample
+		write_samplepos(c);
+	}
+
+	// Run the MCMC chains
+	double acc_modeltime = 0.0;
+	for (int it=0; it < num_samples; ++it) {
+		// 1. Perform 1 multiple-try step of all local chains
+		acc_modeltime += one_step_mtm(it);
+
+		for (size_t c=0; c < num_local_chains; c++) {
+			// 2. write result
+			write_samplepos(c);
+
+			// 3. Get max posterior and the corresponding sample point
+			if (get_pos(c) > max_samplepos[c].back()) {
+				max_samplepos[c] = get_samplepos(c);
+			}
+		}
+		// 4. keeping track
+#if (MCMC_PRINT_PROGRESS == 1)
+		if (par.is_master() && (it+1) % stoi(cfg.get_param_string("mcmc_progress_freq_step")) == 0) {
+			print_progress(it+1, acc_modeltime, max_samplepos[0]);
+		}
+#endif
+	}
+	// MAXPOS is written to the footer on close
+	for (size_t c=0; c < num_local_chains; c++)
+		close_output_file(c);
+
+	if (par.is_master()) {
+		par.info();
+		printf("MCMCMTM: %lu proposals with %lu tries | acceptance %.2f%% | avg.modeltime(sec) per step %.6f\n",
+				num_proposals, num_tries, 100.0 * num_accepted / num_proposals, acc_modeltime / num_samples);
+	}
+	return;
+}
+
+double MultipleTryMetropolis::one_step_mtm(std::size_t it)
+{
+	std::size_t input_size = cfg.get_input_size();
+	std::size_t nc = num_local_chains;
+	std::size_t K = num_tries;
+	std::size_t nt = nc * K;
+	std::size_t nr = nc * (K - 1);
+
+	// 1. K tries of each chain (points outside the input space are evaluated at x, weight 0)
+	vector<char> try_in (nt);
+	for (std::size_t c=0; c < nc; c++) {
+		rngs[c].next_step();
+		for (std::size_t k=0; k < K; k++) {
+			std::size_t col = c*K + k;
+			try_in[col] = draw(c, it, &states[c], nc, &tries[col], nt);
+			if (!try_in[col])
+				for (std::size_t i=0; i < input_size; i++) tries[i*nt + col] = states[i*nc + c];
+		}
+	}
+	double tic = MPI_Wtime();
+	model.compute_posterior_batch(tries, nt, &try_pos[0]);
+	double modeltime = MPI_Wtime() - tic;
+
+	// 2. Select one try by weight, draw the reference set around it
+	vector<double> sum_y (nc, 0.0);
+	vector<char> ref_in (nr);
+	for (std::size_t c=0; c < nc; c++) {
+		for (std::size_t k=0; k < K; k++) {
+			if (!try_in[c*K + k]) try_pos[c*K + k] = 0.0;
+			sum_y[c] += try_pos[c*K + k];
+		}
+		double u = rngs[c].uniform() * sum_y[c];
+		selected[c] = 0;
+		for (double cum = try_pos[c*K]; cum < u && selected[c] + 1 < K; cum += try_pos[c*K + selected[c]])
+			selected[c]++;
+		while (try_pos[c*K + selected[c]] <= 0.0 && selected[c] > 0) selected[c]--;	// rounding at the end
+		std::size_t col = c*K + selected[c];
+		for (std::size_t k=0; k+1 < K; k++) {
+			std::size_t rcol = c*(K-1) + k;
+			ref_in[rcol] = draw(c, it, &tries[col], nt, &refs[rcol], nr);
+			if (!ref_in[rcol])
+				for (std::size_t i=0; i < input_size; i++) refs[i*nr + rcol] = tries[i*nt + col];
+		}
+	}
+	// Reference points are always evaluated, so every rank does the same # of model evaluations
+	if (nr > 0) {
+		tic = MPI_Wtime();
+		model.compute_posterior_batch(refs, nr, &ref_pos[0]);
+		modeltime += MPI_Wtime() - tic;
+	}
+
+	// 3. Accept or reject the selected tries, x is the last reference point
+	double* pos = &states[input_size*nc];
+	for (std::size_t c=0; c < nc; c++) {
+		double sum_x = pos[c];
+		for (std::size_t k=0; k+1 < K; k++)
+			if (ref_in[c*(K-1) + k]) sum_x += ref_pos[c*(K-1) + k];
+		double acc = (sum_y[c] > 0.0) ? fmin(1.0, sum_y[c]/sum_x) : 0.0;
+		if (rngs[c].uniform() <= acc) {
+			std::size_t col = c*K + selected[c];
+			for (std::size_t i=0; i < input_size; i++)
+				proposals[i*nc + c] = tries[i*nt + col];
+			accept_proposal(c, try_pos[col]);
+			num_accepted++;
+		}
+		if (is_am) update_adaptation(c, acc);
+	}
+	if (is_am) end_adaptation_step();
+	num_proposals += nc;
+	return modeltime;
+}
+
+bool MultipleTryMetropolis::draw(
+		std::size_t c,
+		std::size_t it,
+		const double* x, std::size_t x_stride,
+		double* y, std::size_t y_stride)
+{
+	std::size_t input_size = cfg.get_input_size();
+	if (is_am) {
+		// x + scale * L * z, z ~ N(0, I)
+		rngs[c].normal(&am_z[0], input_size);
+		double scale = exp(am_log_scale[c]);
+		const double* L = &am_chol[c*input_size*input_size];
+		for (std::size_t i=0; i < input_size; i++) {
+			double v = 0.0;
+			for (std::size_t j=0; j <= i; j++)
+				v += L[i*input_size + j] * am_z[j];
+			y[i*y_stride] = x[i*x_stride] + scale * v;
+		}
+	} else {
+		// Random walk step = domain size * mcmc_randwalk_step in dimension (it % input_size)
+		std::size_t dim = it % input_size;
+		double randwalk_size = (ranges[dim].second - ranges[dim].first) * cfg.get_param_double("mcmc_randwalk_step");
+		for (std::size_t i=0; i < input_size; i++)
+			y[i*y_stride] = x[i*x_stride];
+		y[dim*y_stride] = rngs[c].normal(x[dim*x_stride], randwalk_size);
+	}
+	for (std::size_t i=0; i < input_size; i++) {
+		if ((y[i*y_stride] < ranges[i].first) || (y[i*y_stride] > ranges[i].second))
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,85 @@
+// eBayes - Elastic Bayesian Inference Framework with iMPI
+// Copyright (C) 2015-today Ao Mo-Hellenbrand
+//
+// All copyrights remain with the respective authors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MCMC_MULTIPLETRYMETROPOLIS_HPP_
+#define MCMC_MULTIPLETRYMETROPOLIS_HPP_
+
+#include <mcmc/MCMC.hpp>
+#include <tools/Config.hpp>
+#include <tools/Parallel.hpp>
+#include <model/ForwardModel.hpp>
+
+#include <mpi.h>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <utility>
+
+/******************************************
+ * Multiple-try Metropolis (Liu, Liang & Wong) with a symmetric proposal kernel T
+ * and weights w(y) = pi(y):
+ *   1. Draw K tries y_1..y_K ~ T(x, .), select y = y_j with probability ~ pi(y_j)
+ *   2. Draw the reference set x*_1..x*_{K-1} ~ T(y, .), x*_K = x
+ *   3. Accept y with min(1, sum pi(y_i) / sum pi(x*_i))
+ * The tries (and then the reference points) of all local chains are evaluated with one batched
+ * model call each, i.e. 2K-1 evaluations per step in 2 calls. K = 1 is Metropolis-Hastings.
+ * Kernel: Gaussian random walk in dimension (step % input_size), or adaptive Metropolis in all
+ * dimensions (mcmc_proposal). Points outside the input space have weight 0 (no redraw, which
+ * would make T asymmetric at the boundary).
+ ******************************************/
+
+class MultipleTryMetropolis : public MCMC
+{
+private:
+	std::size_t num_tries;	// K (mcmc_mtm_tries)
+	std::vector< std::pair<double,double> > ranges;	// Input space
+	// Tries of all local chains, structure-of-arrays with try k of chain c in column (c*K + k),
+	// reference points likewise with K-1 columns per chain
+	std::vector<double> tries;
+	std::vector<double> try_pos;
+	std::vector<double> refs;
+	std::vector<double> ref_pos;
+	std::vector<std::size_t> selected;	// selected try of each local chain
+	// Statistics of the local chains
+	std::size_t num_proposals = 0;
+	std::size_t num_accepted = 0;
+
+public:
+	~MultipleTryMetropolis() {}
+
+	MultipleTryMetropolis(
+			Config const& c,
+			Parallel & p,
+			ForwardModel & m);
+
+	void run(
+			std::size_t num_samples,
+			std::vector<double> const& init_samplepos = std::vector<double>()); // optional init vector
+
+private:
+	double one_step_mtm(std::size_t it);
+
+	// Draws y ~ T(x, .) for local chain c in step it, x and y are input_size values stride apart.
+	// Returns false if y is outside the input space.
+	bool draw(
+			std::size_t c,
+			std::size_t it,
+			const double* x, std::size_t x_stride,
+			double* y, std::size_t y_stride);
+};
+#endif /* MCMC_MULTIPLETRYMETROPOLIS_HPP_ */
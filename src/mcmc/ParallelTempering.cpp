@@ -32,63 +32,53 @@ void ParallelTempering::run(
 		exit(EXIT_FAILURE);
 	}
 
-	// Each MCMC chain is pinned to a MPI process
-	// Ranks with (mpirank > num_chains) do NOT participate in MCMC computation
-	if (par.rank >= num_chains) return;
+	// Each rank advances a block of MCMC chains
+	// Ranks with (mpirank >= num_chain_ranks) do NOT participate in MCMC computation
+	if (par.rank >= num_chain_ranks) return;
 
 	// Output file (only chain0's output is valid output)
-	fstream fout;
 	if (par.is_master()) {
-		fout = open_output_file();
+		open_output_file(0);
 		fflush(NULL);
 		printf("========================================\n");
 	}
 	
 	// Initialize starting point & maxpos point
 	std::size_t input_size = cfg.get_input_size();
-	vector<double> samplepos = initialize_samplepos(init_samplepos);
-	vector<double> max_samplepos = samplepos;
+	initialize_samplepos(init_samplepos);
+	vector<double> max_samplepos = get_samplepos(0);
 	// Write initial MCMC sample
-	if (par.is_master()) write_samplepos(fout, samplepos);
+	if (par.is_master()) write_samplepos(0);
 
 	//=============== Parallel Tempering Stuff =================
-	// Random generators
-	mt19937 gen(chrono::system_clock::now().time_since_epoch().count());
-	uniform_real_distribution<double> udist_r (0.0, 1.0);
-	uniform_int_distribution<int> udist_i (0, num_chains-1);
-	// Pre-determines exchange iterations and ranks:
-	//    To reduce MPI communication, Master pre-determines which iterations (first)
-	//    should be a "potential exchange iteration", and which chain (second) should be swapping
-	//    The swapping chains are always c and c+1 (if c is the last chain, then c+1 is chain 0)
-	vector< pair<int,int> > exchange_iter_chain (num_samples);
-	if (par.is_master()) {
-		double mixing_rate = cfg.get_param_double("mcmc_chain_mixing_rate");
-		for (int i=0; i < num_samples; i++) {
-			if (udist_r(gen) <= mixing_rate) {
-				exchange_iter_chain[i].first = 1;
-				exchange_iter_chain[i].second = udist_i(gen);
-			} else {
-				exchange_iter_chain[i].first = 0;
-				exchange_iter_chain[i].second = -1;
-			}
-		}
-	}
-	MPI_Bcast(&exchange_iter_chain[0], num_samples, MPI_2INT, par.master, MPI_COMM_WORLD);
-	// Exchagne buffer: {sample, posterior, decision}
-	//      [0,input_size-1] sample
-	//		[input_size  ]   posterior
-	//		[input_size+1]   decision
-	vector<double> rbuf (input_size + 2);
+	// Deterministic even-odd swaps (non-reversible): swap rounds alternate between all even
+	// neighbor pairs (0-1, 2-3, ...) and all odd ones (1-2, 3-4, ...), all pairs of a round swap at once.
+	// Whether step it has a round, and the acceptance uniform of each pair, come from the PT stream
+	// at step it, which is identical on all ranks: no exchange plan, no decision messages.
+	RandomStream rng_pt (RNG_STREAM_PT);
+	double mixing_rate = cfg.get_param_double("mcmc_chain_mixing_rate");
+	vector<double> u ((num_chains + 1) / 2);
+	int num_rounds = 0;
+	sbuf.resize(input_size + 2);
+	rbuf.resize(input_size + 2);
 
 	// Initialize temperatures of each chain
 	// 1=T0 < T1 < ... Tmax, with T_i = sqrt(2^i)
 	// For convenience purpose, the inverse of temperatures are stored
-	vector<double> inv_temps (num_chains);
+	inv_temps.resize(num_chains);
 	for (int i=0; i < num_chains; i++)
 		inv_temps[i] = pow(2.0, -double(i)/2.0);
+	local_inv_temps.resize(num_local_chains);
+	for (size_t c=0; c < num_local_chains; c++)
+		local_inv_temps[c] = inv_temps[get_chain_id(c)];
 
-	// Update the initial pos value: pi_i = pi^(1/T_i)
-	samplepos.back() = pow(samplepos.back(), inv_temps[par.rank]);
+	// The ladder is adapted during the first mcmc_pt_adapt_steps steps, then frozen.
+	// Updates are ~20 swap rounds apart, i.e. each neighbor pair has ~10 attempts in between.
+	std::size_t adapt_steps = cfg.get_param_sizet("mcmc_pt_adapt_steps");
+	int adapt_interval = (mixing_rate > 0.0) ? int(ceil(20.0 / mixing_rate)) : 0;
+	int num_updates = 0;
+	acc_sum.assign(num_chains, 0.0);
+	acc_num.assign(num_chains, 0);
 
 #if (MCMC_DEBUG==1)
 	if (par.is_master()) {
@@ -103,74 +93,42 @@ void ParallelTempering::run(
 #endif
 	//=========================================================
 
-	// Run the MCMC chain
-	int dim = 0;
+	// Run the MCMC chains
 	double acc_modeltime = 0.0;
-	double tic;
 	for (int it=0; it < num_samples; ++it) {
-		// 1. Perform 1 MCMC step
-		dim = it%input_size;
-		acc_modeltime += one_step_single_dim(dim, samplepos, inv_temps[par.rank]);
+		// 1. Perform 1 MCMC step of all local chains
+		acc_modeltime += one_step(it, local_inv_temps);
 
 		// 1.1 Mixing chains if needed
-		if (exchange_iter_chain[it].first == 1) {
-			// Engage only the mixing ranks
-			int c1 = exchange_iter_chain[it].second;
-			int c2 = ((c1 + 1) < num_chains) ? (c1 + 1) : 0;
-
-			if ((par.rank == c1) || (par.rank == c2)) {
-				// neighbor rank
-				int nei_chain = (par.rank==c1) ? c2 : c1;
-
-				// acc_i = pi_i^(1/Tj - 1/Ti)
-				// acc_j = pi_j^(1/Ti - 1/Tj))
-				// acc = (acc_i*acc_j, 1)
-
-				// Compute exchange decision, append it to samplepos
-				double acc = pow(samplepos.back(), inv_temps[nei_chain]-inv_temps[par.rank]);
-				samplepos.push_back( (udist_r(gen) < acc) ? 1.0 : 0.0 ); // samplepos is temporary input_size+2 length
-
-				// MPI communication
-				if (par.rank == c1) {
-					MPI_Send(&samplepos[0], input_size+2, MPI_DOUBLE, nei_chain,
-							10, MPI_COMM_WORLD);
-					if (MPI_Recv(&rbuf[0], input_size+2, MPI_DOUBLE, nei_chain,
-							20, MPI_COMM_WORLD, MPI_STATUS_IGNORE) != MPI_SUCCESS) {
-						par.info();
-						printf("ERROR: MCMCPT failed to receive sample from rank %d. Program abort!\n", nei_chain);
-						exit(EXIT_FAILURE);
-					}
-				}
-				if (par.rank == c2) {
-					if (MPI_Recv(&rbuf[0], input_size+2, MPI_DOUBLE, nei_chain,
-							10, MPI_COMM_WORLD, MPI_STATUS_IGNORE) != MPI_SUCCESS) {
-						par.info();
-						printf("ERROR: MCMCPT failed to receive sample from rank %d. Program abort!\n", nei_chain);
-						exit(EXIT_FAILURE);
-					}
-					MPI_Send(&samplepos[0],  input_size+2, MPI_DOUBLE, nei_chain,
-							20, MPI_COMM_WORLD);
-				}
-				// Exchange only if both me and nei accepted
-				if ((samplepos.back() > 0.5) && (rbuf.back() > 0.5)) {
-					samplepos = rbuf;
+		rng_pt.set_step(it);
+		if (rng_pt.uniform() <= mixing_rate) {
+			rng_pt.uniform(&u[0], u.size());
+			swap_round(num_rounds % 2, u, it);
+			num_rounds++;
+		}
+
+		// 1.2 Adapt temperatures during burn-in
+		if ((adapt_interval > 0) && (it+1 < adapt_steps) && ((it+1) % adapt_interval == 0)) {
+			adapt_ladder(num_updates++);
 #if (MCMC_DEBUG==1)
-					if (par.rank == c1) {
-						par.info();
-						printf("MCMCPT: swapped with rank %d at iteration %d.\n", nei_chain, it);
-					}
-#endif
+			if (it+1 + adapt_interval >= adapt_steps) {
+				par.info();
+				printf("MCMCPT: temperatures of chains %lu to %lu frozen after %d updates ...\n",
+						get_chain_id(0), get_chain_id(num_local_chains-1), num_updates);
+				for (auto t = local_inv_temps.begin(); t != local_inv_temps.end(); ++t) {
+					printf("\t%.6f", 1.0 / *t);
 				}
-				samplepos.pop_back(); //remove the exchange decision, samplepos go back to input_size+1 length
+				printf("\n");
 			}
+#endif
 		}
 
 		// 2. write result
-		if (par.is_master()) write_samplepos(fout, samplepos);
+		if (par.is_master()) write_samplepos(0);
 
 		// 3. Get max posterior and the corresponding sample point
-		if (samplepos.back() > max_samplepos.back()) {
-			max_samplepos = samplepos;
+		if (get_pos(0) > max_samplepos.back()) {
+			max_samplepos = get_samplepos(0);
 		}
 		// 4. keeping track
 #if (MCMC_PRINT_PROGRESS == 1)
@@ -179,14 +137,139 @@ void ParallelTempering::run(
 		}
 #endif
 	}
-	// Insert MAXPOS point to file
+	// MAXPOS is written to the footer on close
 	if (par.is_master()) {
 		fflush(NULL);
 		printf("========================================\n\n");
-		fout << "MAXPOS ";
-		write_samplepos(fout, samplepos);
-		fout.close();
+		close_output_file(0);
+	}
+	return;
+}
+
+void ParallelTempering::swap_round(
+		int parity,
+		vector<double> const& u,
+		int it)
+{
+	std::size_t nc = num_local_chains;
+	int first = get_chain_id(0);
+	int last = get_chain_id(nc - 1);
+
+	// 1. Pairs with both chains on this rank: decide and swap in memory
+	int lo = first + ((first % 2 == parity) ? 0 : 1);
+	for (; lo < last; lo += 2) {
+		std::size_t l1 = lo - first;
+		std::size_t l2 = l1 + 1;
+		double acc = get_swap_acc(lo, get_pos(l1), get_pos(l2), local_inv_temps[l1], local_inv_temps[l2]);
+		if (u[lo/2] < acc) {
+			for (std::size_t d=0; d <= cfg.get_input_size(); d++)
+				std::swap(states[d*nc + l1], states[d*nc + l2]);
+#if (MCMC_DEBUG==1)
+			par.info();
+			printf("MCMCPT: swapped chain %d with chain %d at iteration %d.\n", lo, lo+1, it);
+#endif
+		}
+	}
+
+	// 2. Pairs across ranks: lowest local chain with the last chain of rank-1,
+	//    highest local chain with the first chain of rank+1.
+	//    Even ranks talk to rank+1 first, odd ranks to rank-1 first, so all pairs of a phase run at once.
+	bool is_lower = (first > 0) && ((first - 1) % 2 == parity);
+	bool is_upper = (last + 1 < int(num_chains)) && (last % 2 == parity);
+	for (int phase=0; phase < 2; phase++) {
+		bool is_upper_phase = ((par.rank + phase) % 2 == 0);
+		if (is_upper_phase && is_upper)
+			exchange_neighbor(nc - 1, last, last + 1, u[last/2], it);
+		if (!is_upper_phase && is_lower)
+			exchange_neighbor(0, first, first - 1, u[(first-1)/2], it);
 	}
 	return;
 }
 
+void ParallelTempering::exchange_neighbor(
+		std::size_t l,
+		int my_chain,
+		int nei_chain,
+		double u,
+		int it)
+{
+	(void)it; // only printed with MCMC_DEBUG
+	// Chains are blocked by rank, so the neighbor chain is on the neighbor rank
+	int nei_rank = nei_chain / int(num_local_chains);
+	sbuf = get_samplepos(l);
+	sbuf.push_back(local_inv_temps[l]);
+	if (MPI_Sendrecv(&sbuf[0], sbuf.size(), MPI_DOUBLE, nei_rank, 10,
+			&rbuf[0], rbuf.size(), MPI_DOUBLE, nei_rank, 10,
+			MPI_COMM_WORLD, MPI_STATUS_IGNORE) != MPI_SUCCESS) {
+		par.info();
+		printf("ERROR: MCMCPT failed to exchange sample with rank %d. Program abort!\n", nei_rank);
+		exit(EXIT_FAILURE);
+	}
+	inv_temps[nei_chain] = rbuf.back();
+	// Both sides evaluate the same expression with the same shared uniform
+	std::size_t input_size = cfg.get_input_size();
+	bool is_lo = (my_chain < nei_chain);
+	int lo = is_lo ? my_chain : nei_chain;
+	vector<double> const& buf_lo = is_lo ? sbuf : rbuf;
+	vector<double> const& buf_hi = is_lo ? rbuf : sbuf;
+	double acc = get_swap_acc(lo, buf_lo[input_size], buf_hi[input_size],
+			buf_lo[input_size+1], buf_hi[input_size+1]);
+	if (u < acc) {
+		set_samplepos(l, rbuf);
+#if (MCMC_DEBUG==1)
+		if (my_chain == lo) {
+			par.info();
+			printf("MCMCPT: swapped chain %d with chain %d at iteration %d.\n", lo, lo+1, it);
+		}
+#endif
+	}
+	return;
+}
+
+void ParallelTempering::adapt_ladder(int n)
+{
+	std::size_t nc = num_local_chains;
+	int first = get_chain_id(0);
+	int last = get_chain_id(nc - 1);
+
+	// 1. Current temperatures of the neighbor chains on rank-1 and rank+1 (same phases as swaps)
+	for (int phase=0; phase < 2; phase++) {
+		bool is_upper_phase = ((par.rank + phase) % 2 == 0);
+		int nei_rank = is_upper_phase ? par.rank + 1 : par.rank - 1;
+		int my_chain = is_upper_phase ? last : first;
+		int nei_chain = is_upper_phase ? last + 1 : first - 1;
+		if ((nei_chain < 0) || (nei_chain >= int(num_chains))) continue;
+		if (MPI_Sendrecv(&inv_temps[my_chain], 1, MPI_DOUBLE, nei_rank, 30,
+				&inv_temps[nei_chain], 1, MPI_DOUBLE, nei_rank, 30,
+				MPI_COMM_WORLD, MPI_STATUS_IGNORE) != MPI_SUCCESS) {
+			par.info();
+			printf("ERROR: MCMCPT failed to exchange temperature with rank %d. Program abort!\n", nei_rank);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	// 2. A pair with higher acceptance than the other pair of the chain is too narrow:
+	//    move the chain away from it, by at most 45% of the opposite gap, so that
+	//    simultaneously moving neighbors never cross. Gain decays as (n+1)^-0.6.
+	double gain = pow(n + 1.0, -0.6);
+	for (std::size_t c=0; c < nc; c++) {
+		int i = first + c;
+		if ((i == 0) || (i == int(num_chains) - 1) || (acc_num[i-1] == 0) || (acc_num[i] == 0))
+			continue;
+		double acc_lo = acc_sum[i-1] / acc_num[i-1];
+		double acc_hi = acc_sum[i] / acc_num[i];
+		double y = -log(inv_temps[i]);
+		double y_lo = -log(inv_temps[i-1]);
+		double y_hi = -log(inv_temps[i+1]);
+		double step = fmax(-0.45, fmin(0.45, gain * (acc_lo - acc_hi)));
+		y += step * ((step > 0.0) ? (y_hi - y) : (y - y_lo));
+		local_inv_temps[c] = exp(-y);
+	}
+	// Neighbors above used the old values, so update only after all moves
+	for (std::size_t c=0; c < nc; c++)
+		inv_temps[first + c] = local_inv_temps[c];
+
+	std::fill(acc_sum.begin(), acc_sum.end(), 0.0);
+	std::fill(acc_num.begin(), acc_num.end(), 0);
+	return;
+}
@@ -34,8 +34,16 @@
 class ParallelTempering : public MCMC
 {
 private:
-	double mixing_rate; /// [0,1]. How often we should mix (exchange) samples
-	std::unique_ptr<double[]> inv_temps; // Stores the inverse temperatures 1/T_i for all chains
+	// Stores the inverse temperatures 1/T_i for all chains, only those of the local chains
+	// are current (others: last received from the neighbor ranks)
+	std::vector<double> inv_temps;
+	std::vector<double> local_inv_temps;
+	std::vector<double> sbuf;	// Exchange buffers: {sample, posterior, inverse temperature}
+	std::vector<double> rbuf;
+	// Swap acceptance probabilities of neighbor pairs (indexed by the lower chain) since the
+	// last ladder update, only pairs with a local chain are counted
+	std::vector<double> acc_sum;
+	std::vector<int> acc_num;
 
 public:
 	~ParallelTempering() {}
@@ -48,5 +56,37 @@ public:
 	void run(
 			std::size_t num_samples,
 			std::vector<double> const& init_samplepos = std::vector<double>()); // optional init vector
+
+private:
+	// Swap round over all even (parity 0) or odd (parity 1) neighbor pairs of the temperature ladder,
+	// u holds the shared uniform of each pair (pair k starts at chain 2k + parity)
+	void swap_round(
+			int parity,
+			std::vector<double> const& u,
+			int it);
+
+	// Swap acceptance of neighbor chains lo and lo+1 (recorded for ladder adaptation),
+	// identical on both sides of a pair
+	double get_swap_acc(
+			int lo,
+			double pos_lo,
+			double pos_hi,
+			double inv_temp_lo,
+			double inv_temp_hi) {
+		double acc = fmin(1.0, pow(pos_hi/pos_lo, inv_temp_lo-inv_temp_hi));
+		acc_sum[lo] += acc;
+		acc_num[lo]++;
+		return acc;}
+
+	void exchange_neighbor(
+			std::size_t l,
+			int my_chain,
+			int nei_chain,
+			double u,
+			int it);
+
+	// Burn-in: move each interior chain in log(T) towards equal swap acceptance with its lower and
+	// upper neighbor (T of the first and last chain stay fixed), n = number of previous updates
+	void adapt_ladder(int n);
 };
 #endif /* MCMC_PARALLELTEMPERING_HPP_ */
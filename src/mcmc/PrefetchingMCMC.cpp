@@ -0,0 +1,211 @@
+// eBayes - Elastic Bayesian Inference Framework with iMPI
+// Copyright (C) 2015-today Ao Mo-Hellenbrand
+//
+// All copyrights remain with the respective authors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <mcmc/PrefetchingMCMC.hpp>
+
+using namespace std;
+
+
+PrefetchingMCMC::PrefetchingMCMC(
+		Config const& c,
+		Parallel & p,
+		ForwardModel & m)
+		: MCMC(c, p, m)
+{
+	if (num_local_chains != 1 || is_am) {
+		par.info();
+		printf("ERROR: prefetching MCMC needs mcmc_chains_per_rank 1 and mcmc_proposal randwalk. Program abort!\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+void PrefetchingMCMC::run(
+			std::size_t num_samples,
+			std::vector<double> const& init_samplepos)
+{
+	// Rank r evaluates for the chain of rank (r % num_chain_ranks)
+	MPI_Comm_split(MPI_COMM_WORLD, int(par.rank % num_chain_ranks), par.rank, &group);
+	MPI_Comm_size(group, &group_size);
+	MPI_Comm_rank(group, &group_rank);
+	std::size_t input_size = cfg.get_input_size();
+	slots.resize(group_size * (input_size + 1));
+	slot_pos.resize(group_size);
+	if (group_rank != 0) {
+		serve();
+		MPI_Comm_free(&group);
+		return;
+	}
+
+	// Output file
+	open_output_file(0);
+
+	// Initialize starting point & maxpos point
+	initialize_samplepos(init_samplepos);
+	vector<double> max_samplepos = get_samplepos(0);
+	// Write initial MCMC sample
+	write_samplepos(0);
+
+	// Run the MCMC chain, each round takes one or more steps
+	double acc_modeltime = 0.0;
+	std::size_t it = 0;
+	while (it < num_samples) {
+		// 1. Evaluate the most probable nodes of the next steps
+		vector<size_t> selected = select_nodes(it, num_samples);
+		acc_modeltime += eval_nodes(selected);
+		num_rounds++;
+
+		// 2. Follow the accept decisions while the nodes are evaluated
+		//    (the root, i.e. the proposal of step it, is always evaluated)
+		std::size_t n = 0;
+		while (tree[n].is_eval) {
+			Node const& node = tree[n];
+			double acc = fmin(1.0, node.pos/get_pos(0));
+			bool is_accept = (node.u <= acc);
+			if (is_accept) {
+				for (std::size_t i=0; i < input_size; i++)
+					states[i] = node.proposal[i];
+				get_pos(0) = node.pos;
+				num_accepted++;
+			}
+			num_steps++;
+			it++;
+			// 3. write result
+			write_samplepos(0);
+
+			// 4. Get max posterior and the corresponding sample point
+			if (get_pos(0) > max_samplepos.back()) {
+				max_samplepos = get_samplepos(0);
+			}
+			// 5. keeping track
+#if (MCMC_PRINT_PROGRESS == 1)
+			if (par.is_master() && it % stoi(cfg.get_param_string("mcmc_progress_freq_step")) == 0) {
+				print_progress(it, acc_modeltime, max_samplepos);
+			}
+#endif
+			if (it >= num_samples || node.child[is_accept] == 0) break;
+			n = node.child[is_accept];
+		}
+	}
+	// Release the helper ranks
+	for (int r=0; r < group_size; r++)
+		slots[r*(input_size+1)] = PF_STOP;
+	MPI_Scatter(&slots[0], input_size+1, MPI_DOUBLE, MPI_IN_PLACE, input_size+1, MPI_DOUBLE, 0, group);
+	MPI_Comm_free(&group);
+
+	// MAXPOS is written to the footer on close
+	close_output_file(0);
+
+	if (par.is_master()) {
+		par.info();
+		printf("MCMCPF: %lu steps in %lu rounds of %d evaluations | %.2f steps per round | acceptance %.2f%%\n",
+				num_steps, num_rounds, group_size, double(num_steps) / num_rounds,
+				100.0 * num_accepted / num_steps);
+	}
+	return;
+}
+
+std::size_t PrefetchingMCMC::add_node(std::size_t step, vector<double> const& base, double prob)
+{
+	// Draws of step s use the counter block s+1 (see propose), as in the sequential chain
+	vector<double> cur = get_samplepos(0);
+	set_samplepos(0, base);
+	rngs[0].set_step(step);
+	propose(step);
+	Node node;
+	node.step = step;
+	node.base = base;
+	node.proposal.assign(proposals.begin(), proposals.end());
+	node.u = rngs[0].uniform();
+	node.prob = prob;
+	tree.push_back(node);
+	set_samplepos(0, cur);
+	return tree.size() - 1;
+}
+
+vector<size_t> PrefetchingMCMC::select_nodes(std::size_t it, std::size_t num_samples)
+{
+	// Acceptance rate of the chain so far (prior 1/4)
+	double a = (num_accepted + 1.0) / (num_steps + 4.0);
+	tree.clear();
+	add_node(it, get_samplepos(0), 1.0);
+	// Best-first: the most probable node is evaluated next, its two children become candidates
+	priority_queue< pair<double, size_t> > candidates;
+	candidates.push(make_pair(1.0, size_t(0)));
+	vector<size_t> selected;
+	while (selected.size() < size_t(group_size) && !candidates.empty()) {
+		std::size_t n = candidates.top().second;
+		candidates.pop();
+		selected.push_back(n);
+		if (tree[n].step + 1 >= num_samples) continue;
+		// Reject keeps the base, accept moves to the proposal (its posterior is not needed to propose)
+		std::size_t step = tree[n].step + 1;
+		double prob = tree[n].prob;
+		vector<double> base = tree[n].base;
+		vector<double> moved = tree[n].proposal;
+		moved.push_back(0.0);
+		std::size_t rej = add_node(step, base, prob * (1.0 - a));
+		std::size_t acc = add_node(step, moved, prob * a);
+		tree[n].child[0] = rej;
+		tree[n].child[1] = acc;
+		candidates.push(make_pair(tree[rej].prob, rej));
+		candidates.push(make_pair(tree[acc].prob, acc));
+	}
+	return selected;
+}
+
+double PrefetchingMCMC::eval_nodes(vector<size_t> const& selected)
+{
+	std::size_t input_size = cfg.get_input_size();
+	double tic = MPI_Wtime();
+	for (int r=0; r < group_size; r++) {
+		double* slot = &slots[r*(input_size+1)];
+		if (size_t(r) < selected.size()) {
+			slot[0] = PF_EVAL;
+			std::copy(tree[selected[r]].proposal.begin(), tree[selected[r]].proposal.end(), slot + 1);
+		} else {
+			slot[0] = PF_IDLE;
+		}
+	}
+	// Group rank 0 evaluates the root itself
+	MPI_Scatter(&slots[0], input_size+1, MPI_DOUBLE, MPI_IN_PLACE, input_size+1, MPI_DOUBLE, 0, group);
+	double pos = model.compute_posterior(tree[selected[0]].proposal);
+	MPI_Gather(&pos, 1, MPI_DOUBLE, &slot_pos[0], 1, MPI_DOUBLE, 0, group);
+	for (std::size_t k=0; k < selected.size(); k++) {
+		tree[selected[k]].pos = slot_pos[k];
+		tree[selected[k]].is_eval = true;
+	}
+	return MPI_Wtime() - tic;
+}
+
+void PrefetchingMCMC::serve()
+{
+	std::size_t input_size = cfg.get_input_size();
+	vector<double> slot (input_size + 1);
+	vector<double> m (input_size);
+	while (true) {
+		MPI_Scatter(NULL, 0, MPI_DOUBLE, &slot[0], input_size+1, MPI_DOUBLE, 0, group);
+		if (int(slot[0]) == PF_STOP) break;
+		double pos = 0.0;
+		if (int(slot[0]) == PF_EVAL) {
+			std::copy(slot.begin() + 1, slot.end(), m.begin());
+			pos = model.compute_posterior(m);
+		}
+		MPI_Gather(&pos, 1, MPI_DOUBLE, NULL, 0, MPI_DOUBLE, 0, group);
+	}
+	return;
+}
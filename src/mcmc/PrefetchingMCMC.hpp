@@ -0,0 +1,103 @@
+// eBayes - Elastic Bayesian Inference Framework with iMPI
+// Copyright (C) 2015-today Ao Mo-Hellenbrand
+//
+// All copyrights remain with the respective authors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MCMC_PREFETCHINGMCMC_HPP_
+#define MCMC_PREFETCHINGMCMC_HPP_
+
+#include <mcmc/MCMC.hpp>
+#include <tools/Config.hpp>
+#include <tools/Parallel.hpp>
+#include <model/ForwardModel.hpp>
+
+#include <mpi.h>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <queue>
+#include <utility>
+
+// Command of a group rank in a round
+#define PF_IDLE		0
+#define PF_EVAL		1
+#define PF_STOP		2
+
+/******************************************
+ * Prefetching Metropolis-Hastings (Brockwell; Strens): each chain rank leads a group of the
+ * ranks beyond num_chain_ranks (rank r belongs to the chain of rank r % num_chain_ranks).
+ * Per round, the group evaluates the most probable nodes of the accept/reject tree of the
+ * next steps at once, and the chain consumes the path that actually happens, i.e. up to
+ * group size steps per round of model evaluations.
+ * Random streams are keyed by (chain, step), so the proposal and the uniform of every node
+ * are those of the sequential chain: the samples are identical to Metropolis-Hastings.
+ * Requires mcmc_chains_per_rank = 1 and mcmc_proposal = randwalk (adaptive proposals depend
+ * on the accept decisions of the path).
+ ******************************************/
+
+class PrefetchingMCMC : public MCMC
+{
+private:
+	// Proposal of step `step` from the state `base` (sample only), with the uniform of its accept
+	// decision and the probability that the chain gets there (from the acceptance rate so far)
+	struct Node {
+		std::size_t step;
+		std::vector<double> base;
+		std::vector<double> proposal;
+		double u;
+		double prob;
+		double pos = 0.0;
+		bool is_eval = false;
+		std::size_t child[2] = {0, 0};	// reject, accept (0 = not expanded, the root is never a child)
+	};
+	MPI_Comm group = MPI_COMM_NULL;	// Ranks evaluating for this chain, the chain rank is group rank 0
+	int group_size = 1;
+	int group_rank = 0;
+	std::vector<Node> tree;
+	// One slot of (1 + input_size) per group rank: command (see PF_*) and the proposal
+	std::vector<double> slots;
+	std::vector<double> slot_pos;
+	// Statistics of the chain
+	std::size_t num_rounds = 0;
+	std::size_t num_steps = 0;
+	std::size_t num_accepted = 0;
+
+public:
+	~PrefetchingMCMC() {}
+
+	PrefetchingMCMC(
+			Config const& c,
+			Parallel & p,
+			ForwardModel & m);
+
+	void run(
+			std::size_t num_samples,
+			std::vector<double> const& init_samplepos = std::vector<double>()); // optional init vector
+
+private:
+	// Node of step `step` from base, replays the draws of that step
+	std::size_t add_node(std::size_t step, std::vector<double> const& base, double prob);
+
+	// Expands the tree from step it of the current state, returns the nodes to evaluate (at most group_size)
+	std::vector<std::size_t> select_nodes(std::size_t it, std::size_t num_samples);
+
+	// Posteriors of the selected nodes by all group ranks, returns the time of the round
+	double eval_nodes(std::vector<std::size_t> const& selected);
+
+	// Evaluation loop of the helper ranks until the chain is done
+	void serve();
+};
+#endif /* MCMC_PREFETCHINGMCMC_HPP_ */
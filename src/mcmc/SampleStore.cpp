@@ -0,0 +1,209 @@
+// eBayes - Elastic Bayesian Inference Framework with iMPI
+// Copyright (C) 2015-today Ao Mo-Hellenbrand
+//
+// All copyrights remain with the respective authors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <mcmc/SampleStore.hpp>
+
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+
+SampleStore::SampleStore(
+		std::size_t d,
+		std::size_t c)
+		: dim(d), chunk_size((c > 0) ? c : 1), record_len(d + 1)
+{
+	memset(&header, 0, sizeof(header));
+}
+
+bool SampleStore::open(
+		string const& fname,
+		uint32_t chain,
+		double temperature)
+{
+	close();
+	fp = fopen(fname.c_str(), "wb");
+	if (fp == nullptr) return false;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SAMPLESTORE_MAGIC, sizeof(header.magic));
+	header.version = SAMPLESTORE_VERSION;
+	header.dim = uint32_t(dim);
+	header.chain = chain;
+	header.record_bytes = uint32_t(record_len * sizeof(double));
+	header.temperature = temperature;
+	header.chunk_size = chunk_size;
+	if (fwrite(&header, sizeof(header), 1, fp) != 1) {
+		fclose(fp);
+		fp = nullptr;
+		return false;
+	}
+
+	num_records = 0;
+	num_moves = 0;
+	maxpos.clear();
+	mean.assign(record_len, 0.0);
+	m2.assign(record_len, 0.0);
+	prev.clear();
+	is_stop = false;
+	is_failed = false;
+
+	cur.clear();
+	cur.reserve(chunk_size * record_len);
+	writer = thread(&SampleStore::write_loop, this);
+	return true;
+}
+
+void SampleStore::write(
+		const double* samplepos,
+		std::size_t stride)
+{
+	for (std::size_t k=0; k < record_len; k++)
+		cur.push_back(samplepos[k*stride]);
+	if (cur.size() < chunk_size * record_len) return;
+
+	// Hand the full chunk to the writer, continue with a written one
+	vector<double> next;
+	{
+		lock_guard<mutex> lock (mtx);
+		full.push_back(std::move(cur));
+		if (!reuse.empty()) {
+			next = std::move(reuse.back());
+			reuse.pop_back();
+		}
+	}
+	cv.notify_one();
+	next.clear();
+	next.reserve(chunk_size * record_len);
+	cur = std::move(next);
+}
+
+bool SampleStore::close()
+{
+	if (fp == nullptr) return true;
+
+	// Last (partial) chunk, then stop the writer
+	{
+		lock_guard<mutex> lock (mtx);
+		if (!cur.empty()) full.push_back(std::move(cur));
+		is_stop = true;
+	}
+	cv.notify_one();
+	writer.join();
+	cur.clear();
+	reuse.clear();
+
+	// Footer: counters, MAXPOS, mean, variance
+	vector<double> var (record_len, 0.0);
+	if (num_records > 1) {
+		for (size_t k=0; k < record_len; k++) var[k] = m2[k] / double(num_records - 1);
+	}
+	if (maxpos.empty()) maxpos.assign(record_len, 0.0);
+
+	long footer_offset = ftell(fp);
+	char magic[8];
+	memcpy(magic, SAMPLESTORE_FOOTER_MAGIC, sizeof(magic));
+	bool is_ok = !is_failed && (footer_offset >= 0)
+			&& (fwrite(magic, sizeof(magic), 1, fp) == 1)
+			&& (fwrite(&num_records, sizeof(uint64_t), 1, fp) == 1)
+			&& (fwrite(&num_moves, sizeof(uint64_t), 1, fp) == 1)
+			&& (fwrite(&maxpos[0], sizeof(double), record_len, fp) == record_len)
+			&& (fwrite(&mean[0], sizeof(double), record_len, fp) == record_len)
+			&& (fwrite(&var[0], sizeof(double), record_len, fp) == record_len);
+
+	// Header is patched last, so a complete header implies a complete file
+	if (is_ok) {
+		header.num_records = num_records;
+		header.footer_offset = uint64_t(footer_offset);
+		is_ok = (fseek(fp, 0, SEEK_SET) == 0)
+				&& (fwrite(&header, sizeof(header), 1, fp) == 1);
+	}
+	is_ok = (fclose(fp) == 0) && is_ok;
+	fp = nullptr;
+	return is_ok;
+}
+
+vector<double> SampleStore::read_maxpos(string const& fname)
+{
+	vector<double> samplepos;
+	FILE* f = fopen(fname.c_str(), "rb");
+	if (f == nullptr) return samplepos;
+
+	SampleStoreHeader h;
+	char magic[8];
+	uint64_t counts[2];
+	if ((fread(&h, sizeof(h), 1, f) == 1)
+			&& (memcmp(h.magic, SAMPLESTORE_MAGIC, sizeof(h.magic)) == 0)
+			&& (h.footer_offset > 0)
+			&& (fseek(f, long(h.footer_offset), SEEK_SET) == 0)
+			&& (fread(magic, sizeof(magic), 1, f) == 1)
+			&& (memcmp(magic, SAMPLESTORE_FOOTER_MAGIC, sizeof(magic)) == 0)
+			&& (fread(counts, sizeof(uint64_t), 2, f) == 2)) {
+		samplepos.resize(h.dim + 1);
+		if (fread(&samplepos[0], sizeof(double), samplepos.size(), f) != samplepos.size())
+			samplepos.clear();
+	}
+	fclose(f);
+	return samplepos;
+}
+
+void SampleStore::write_loop()
+{
+	for (;;) {
+		vector<double> chunk;
+		{
+			unique_lock<mutex> lock (mtx);
+			cv.wait(lock, [this]{return is_stop || !full.empty();});
+			if (full.empty()) return; // stopped and drained
+			chunk = std::move(full.front());
+			full.pop_front();
+		}
+		if (fwrite(&chunk[0], sizeof(double), chunk.size(), fp) != chunk.size())
+			is_failed = true;
+		update_stats(chunk);
+		{
+			lock_guard<mutex> lock (mtx);
+			reuse.push_back(std::move(chunk));
+		}
+	}
+}
+
+void SampleStore::update_stats(vector<double> const& chunk)
+{
+	for (size_t r=0; r < chunk.size(); r += record_len) {
+		double const* rec = &chunk[r];
+		num_records++;
+		// MAXPOS: first record with the highest posterior
+		if (maxpos.empty() || (rec[dim] > maxpos[dim]))
+			maxpos.assign(rec, rec + record_len);
+		// Moved if the sample differs from the previous record
+		if (!prev.empty() && !equal(rec, rec + dim, prev.begin()))
+			num_moves++;
+		prev.assign(rec, rec + record_len);
+		// Welford mean and variance
+		for (size_t k=0; k < record_len; k++) {
+			double delta = rec[k] - mean[k];
+			mean[k] += delta / double(num_records);
+			m2[k] += delta * (rec[k] - mean[k]);
+		}
+	}
+	return;
+}
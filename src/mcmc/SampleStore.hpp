@@ -0,0 +1,119 @@
+// eBayes - Elastic Bayesian Inference Framework with iMPI
+// Copyright (C) 2015-today Ao Mo-Hellenbrand
+//
+// All copyrights remain with the respective authors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef MCMC_SAMPLESTORE_HPP_
+#define MCMC_SAMPLESTORE_HPP_
+
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/******************************************
+ * Binary MCMC sample file (native byte order), one file per chain:
+ *   - Header (64 bytes): SampleStoreHeader
+ *   - Records from byte 64 on: (dim + 1) doubles each, sample followed by its posterior
+ *   - Footer at header.footer_offset:
+ *       magic[8], uint64 num_records, uint64 num_moves,
+ *       double maxpos[dim+1], double mean[dim+1], double var[dim+1]
+ * num_records and footer_offset are 0 until the store is closed, records of an
+ * interrupted run can still be read up to the file size.
+ ******************************************/
+
+#define SAMPLESTORE_MAGIC			"EBMCMCS"
+#define SAMPLESTORE_FOOTER_MAGIC	"EBMCMCF"
+#define SAMPLESTORE_VERSION			1
+
+struct SampleStoreHeader {
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	dim;			// sample dimension (record = dim + 1 doubles)
+	uint32_t	chain;			// chain id
+	uint32_t	record_bytes;
+	double		temperature;	// temperature of the chain (1 = posterior)
+	uint64_t	num_records;
+	uint64_t	footer_offset;
+	uint64_t	chunk_size;		// records per write
+	uint64_t	reserved;
+};
+static_assert(sizeof(SampleStoreHeader) == 64, "SampleStoreHeader must be 64 bytes");
+
+/**
+ * Samples are copied into a chunk buffer, full chunks are written by a background
+ * thread, which also keeps MAXPOS, mean, variance and number of moves for the footer.
+ * The sampling loop never formats or flushes.
+ */
+class SampleStore
+{
+public:
+	~SampleStore() {close();}
+
+	SampleStore(std::size_t dim, std::size_t chunk_size);
+
+	// Returns false if the file cannot be created
+	bool open(std::string const& fname, uint32_t chain, double temperature = 1.0);
+
+	// Appends a record, samplepos has length (dim + 1)
+	void write(std::vector<double> const& samplepos) {write(&samplepos[0], 1);}
+
+	// Appends a record whose (dim + 1) values are stride apart (e.g. a column of a row-major matrix)
+	void write(const double* samplepos, std::size_t stride);
+
+	// Writes the remaining records and the footer, joins the writer thread.
+	// Returns false if any write failed.
+	bool close();
+
+	// MAXPOS record (dim + 1) of a closed file, empty if the file is missing or incomplete
+	static std::vector<double> read_maxpos(std::string const& fname);
+
+private:
+	std::size_t			dim;
+	std::size_t			chunk_size;
+	std::size_t			record_len;	// dim + 1
+	std::FILE*			fp = nullptr;
+	SampleStoreHeader	header;
+	std::vector<double>	cur;		// chunk being filled by the sampling thread
+
+	// Writer thread
+	std::thread			writer;
+	std::mutex			mtx;
+	std::condition_variable	cv;
+	std::deque< std::vector<double> >	full;	// chunks to be written
+	std::vector< std::vector<double> >	reuse;	// written chunks for reuse
+	bool				is_stop = false;
+	bool				is_failed = false;
+
+	// Footer statistics (writer thread only)
+	uint64_t			num_records = 0;
+	uint64_t			num_moves = 0;
+	std::vector<double>	maxpos;
+	std::vector<double>	mean;
+	std::vector<double>	m2;
+	std::vector<double>	prev;
+
+	void write_loop();
+
+	void update_stats(std::vector<double> const& chunk);
+};
+#endif /* MCMC_SAMPLESTORE_HPP_ */
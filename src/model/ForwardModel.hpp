@@ -46,5 +46,23 @@ public:
 
 	virtual std::vector<double> run(
 			std::vector<double> const& m) = 0;
+
+	// Posterior of input m. A surrogate may override this with a cheaper path.
+	virtual double compute_posterior(std::vector<double> const& m) {
+		return cfg.compute_posterior(run(m));}
+
+	// Posteriors of n inputs stored as structure-of-arrays, i.e. dimension d of input c at
+	// ms[d*n + c] (further rows are ignored). A surrogate may override this with a batched path.
+	virtual void compute_posterior_batch(
+			std::vector<double> const& ms,
+			std::size_t n,
+			double* pos) {
+		std::size_t input_size = cfg.get_input_size();
+		std::vector<double> m (input_size);
+		for (std::size_t c=0; c < n; c++) {
+			for (std::size_t d=0; d < input_size; d++) m[d] = ms[d*n + c];
+			pos[c] = compute_posterior(m);
+		}
+	}
 };
 #endif /* MODEL_FORWARDMODEL_HPP_ */
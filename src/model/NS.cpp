@@ -33,7 +33,7 @@ NS::~NS()
 	this->out_locs.clear();
 }
 
-NS::NS(Config const& c)
+NS::NS(Config const& c, std::size_t coarsen)
 		: ForwardModel(c)
 {
 	this->domain_size_x = cfg.get_param_double("ns_domain_size_x");
@@ -50,8 +50,8 @@ NS::NS(Config const& c)
 	this->alpha = cfg.get_param_double("ns_alpha");
 	this->omega = cfg.get_param_double("ns_omega");
 
-	std::size_t rx = cfg.get_param_sizet("ns_resx");
-	std::size_t ry = cfg.get_param_sizet("ns_resy");
+	std::size_t rx = cfg.get_param_sizet("ns_resx") / coarsen;
+	std::size_t ry = cfg.get_param_sizet("ns_resy") / coarsen;
 	if (rx < 1) rx = 1;
 	if (ry < 1) ry = 1;
 	this->ncx = cfg.get_param_sizet("ns_min_ncx") * rx;
@@ -41,7 +41,8 @@ class NS : public ForwardModel
 {
 public:
 	~NS();
-	NS(Config const& c);
+	// Resolution multipliers (ns_resx, ns_resy) are divided by coarsen (coarse levels of multilevel MCMC)
+	NS(Config const& c, std::size_t coarsen = 1);
 
 	std::pair<double,double> get_input_space(int dim) const;
 
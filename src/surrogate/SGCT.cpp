@@ -0,0 +1,240 @@
+// eBayes - Elastic Bayesian Inference Framework with iMPI
+// Copyright (C) 2015-today Ao Mo-Hellenbrand
+//
+// All copyrights remain with the respective authors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <surrogate/SGCT.hpp>
+
+using namespace std;
+
+
+SGCT::SGCT(
+		Config const& c,
+		Parallel & p,
+		ForwardModel & m)
+		: ForwardModel(c), par(p), fullmodel(m)
+{
+}
+
+vector<double> SGCT::run(
+		vector<double> const& m)
+{
+	// Grid check
+	if (grids.empty()) {
+		par.info();
+		printf("ERROR: SGCT::run fail because surrogate is not properly built. Program abort!\n");
+		exit(EXIT_FAILURE);
+	}
+	std::size_t input_size = cfg.get_input_size();
+	std::size_t output_size = cfg.get_output_size();
+	vector<double> d (output_size, 0.0);
+	// Scale m to unit cube
+	vector<double> x (input_size);
+	for (std::size_t i=0; i < input_size; i++) {
+		pair<double,double> range = fullmodel.get_input_space(i);
+		x[i] = fmin(1.0, fmax(0.0, (m[i] - range.first) / (range.second - range.first)));
+	}
+	vector<std::size_t> low (input_size);
+	vector<double> w (input_size);
+	vector<std::size_t> active; // dimensions with more than 1 point
+	for (auto const& g: grids) {
+		// 1. In each dimension: left point of the cell containing x, and weight of the right point
+		//    (cells at both ends are extrapolated linearly)
+		active.clear();
+		for (std::size_t i=0; i < input_size; i++) {
+			if (g.sizes[i] == 1) {
+				low[i] = 0;
+				continue;
+			}
+			double t = x[i] * double(1u << g.levels[i]) - 1.0; // position in point units
+			low[i] = static_cast<std::size_t>(fmin(fmax(floor(t), 0.0), double(g.sizes[i]-2)));
+			w[i] = t - double(low[i]);
+			active.push_back(i);
+		}
+		std::size_t base = 0;
+		for (std::size_t i=0; i < input_size; i++)
+			base = base * g.sizes[i] + low[i];
+		// 2. Sum over the 2^(# active dims) corners of the cell
+		for (std::size_t c=0; c < (std::size_t(1) << active.size()); c++) {
+			double weight = g.coeff;
+			std::size_t pos = base;
+			for (std::size_t a=0; a < active.size(); a++) {
+				std::size_t i = active[a];
+				if (c & (std::size_t(1) << a)) {
+					weight *= w[i];
+					pos += g.strides[i];
+				} else {
+					weight *= 1.0 - w[i];
+				}
+			}
+			const double* v = &g.values[pos * output_size];
+			for (std::size_t j=0; j < output_size; j++)
+				d[j] += weight * v[j];
+		}
+	}
+	return d;
+}
+
+void SGCT::build()
+{
+#if (SGI_PRINT_TIMER==1)
+	double tic = MPI_Wtime();
+#endif
+	std::size_t output_size = cfg.get_output_size();
+	level = (level == 0) ? cfg.get_param_sizet("sgct_init_level") : level + 1;
+	if (par.is_master()) {
+		fflush(NULL);
+		printf("==========================================\n");
+		printf("SGCT: Building SGCT surrogate level %lu...\n", level);
+	}
+	// 1. All: set up component grids
+	create_component_grids();
+	// 2. All: find points not computed yet
+	vector< vector<uint32_t> > todo;
+	std::size_t num_points = 0;
+	for (auto const& g: grids) {
+		std::size_t n = g.values.size() / output_size;
+		num_points += n;
+		for (std::size_t pos=0; pos < n; pos++) {
+			vector<uint32_t> key = get_point_key(g, pos);
+			if (point_data.find(key) == point_data.end()) {
+				point_data[key] = vector<double>();
+				todo.push_back(key);
+			}
+		}
+	}
+	// 3. All: compute new points
+	compute_points(todo);
+	// 4. All: fill component grids
+	for (auto& g: grids) {
+		std::size_t n = g.values.size() / output_size;
+		for (std::size_t pos=0; pos < n; pos++) {
+			vector<double> const& data = point_data[get_point_key(g, pos)];
+			std::copy(data.begin(), data.end(), &g.values[pos * output_size]);
+		}
+	}
+	if (par.is_master()) {
+		fflush(NULL);
+		printf("SGCT: %lu component grids, %lu points (%lu unique, %lu new)\n",
+				grids.size(), num_points, point_data.size(), todo.size());
+#if (SGI_PRINT_TIMER==1)
+		printf("SGCT: built in %.6f sec\n", MPI_Wtime()-tic);
+#endif
+		printf("SGCT: Build SGCT surrogate successful.\n");
+		printf("==========================================\n");
+	}
+	return;
+}
+
+
+/*********************************************
+ *       		 Private Methods
+ *********************************************/
+/**
+ * Combination technique (levels start from 1):
+ * 		f = sum_{q=0}^{d-1} (-1)^q * binom(d-1, q) * sum_{|l|_1 = level+d-1-q} f_l
+ */
+void SGCT::create_component_grids()
+{
+	std::size_t input_size = cfg.get_input_size();
+	grids.clear();
+	vector<unsigned int> levels (input_size);
+	double binom = 1.0;
+	for (std::size_t q=0; q < input_size; q++) {
+		if (q > 0) binom = binom * double(input_size - q) / double(q);
+		if (level + input_size - 1 < q + input_size) break; // |l|_1 >= d
+		unsigned int levelsum = level + input_size - 1 - q;
+		add_levels(levels, 0, levelsum, ((q % 2) ? -1.0 : 1.0) * binom);
+	}
+	return;
+}
+
+void SGCT::add_levels(
+		vector<unsigned int>& levels,
+		std::size_t dim,
+		unsigned int remaining,
+		double coeff)
+{
+	std::size_t input_size = cfg.get_input_size();
+	std::size_t dims_left = input_size - dim - 1;
+	if (dims_left == 0) {
+		if ((remaining < 1) || (remaining > SGCT_MAX_LEVEL)) return;
+		levels[dim] = remaining;
+		ComponentGrid g;
+		g.levels = levels;
+		g.coeff = coeff;
+		for (auto l: levels)
+			g.sizes.push_back((std::size_t(1) << l) - 1);
+		g.strides.resize(input_size);
+		std::size_t n = 1;
+		for (std::size_t i=input_size; i-- > 0; ) {
+			g.strides[i] = n;
+			n *= g.sizes[i];
+		}
+		g.values.resize(n * cfg.get_output_size());
+		grids.push_back(g);
+		return;
+	}
+	// every remaining dimension needs at least level 1
+	for (unsigned int l=1; l + dims_left <= remaining && l <= SGCT_MAX_LEVEL; l++) {
+		levels[dim] = l;
+		add_levels(levels, dim+1, remaining-l, coeff);
+	}
+	return;
+}
+
+vector<uint32_t> SGCT::get_point_key(
+		ComponentGrid const& g,
+		std::size_t pos)
+{
+	std::size_t input_size = cfg.get_input_size();
+	vector<uint32_t> key (input_size);
+	for (std::size_t i=input_size; i-- > 0; ) {
+		std::size_t idx = pos % g.sizes[i] + 1; // index in [1, 2^l-1]
+		pos /= g.sizes[i];
+		key[i] = static_cast<uint32_t>(idx << (SGCT_MAX_LEVEL - g.levels[i]));
+	}
+	return key;
+}
+
+vector<double> SGCT::get_point_coord(vector<uint32_t> const& key)
+{
+	vector<double> m (key.size());
+	for (std::size_t i=0; i < key.size(); i++) {
+		pair<double,double> range = fullmodel.get_input_space(i);
+		m[i] = range.first + (range.second - range.first) * double(key[i]) / double(1u << SGCT_MAX_LEVEL);
+	}
+	return m;
+}
+
+/**
+ * Points are independent: rank r computes points r, r+size, r+2*size, ...
+ * then all ranks sum up the results.
+ */
+void SGCT::compute_points(vector< vector<uint32_t> > const& keys)
+{
+	std::size_t output_size = cfg.get_output_size();
+	vector<double> buff (keys.size() * output_size, 0.0);
+	for (std::size_t k=par.rank; k < keys.size(); k += par.size) {
+		vector<double> d = fullmodel.run(get_point_coord(keys[k]));
+		std::copy(d.begin(), d.end(), &buff[k * output_size]);
+	}
+	if (!buff.empty())
+		MPI_Allreduce(MPI_IN_PLACE, &buff[0], buff.size(), MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+	for (std::size_t k=0; k < keys.size(); k++)
+		point_data[keys[k]].assign(&buff[k * output_size], &buff[k * output_size] + output_size);
+	return;
+}
@@ -0,0 +1,96 @@
+// eBayes - Elastic Bayesian Inference Framework with iMPI
+// Copyright (C) 2015-today Ao Mo-Hellenbrand
+//
+// All copyrights remain with the respective authors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SURROGATE_SGCT_HPP_
+#define SURROGATE_SGCT_HPP_
+
+#include <model/ForwardModel.hpp>
+#include <tools/Parallel.hpp>
+#include <tools/Config.hpp>
+
+#include <mpi.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <map>
+
+// Point coordinates are stored as integers in units of 2^-SGCT_MAX_LEVEL
+#define SGCT_MAX_LEVEL 30
+
+/**
+ * Sparse grid combination technique surrogate:
+ * 		f(x) ~= sum_c ( coeff_c * f_c(x) )
+ * where f_c is the multilinear interpolant on an (anisotropic) full grid with levels l_c.
+ * A 1D grid of level l has 2^l-1 inner points, and is extrapolated linearly towards the boundary
+ * (same function space as the modified linear basis of SGI).
+ */
+class SGCT : public ForwardModel
+{
+public:
+	~SGCT(){}
+
+	SGCT(
+		Config const& c,
+		Parallel & p,
+		ForwardModel & m);
+
+	std::vector<double> run(
+			std::vector<double> const& m);
+
+	// First call builds level sgct_init_level, each further call adds one level
+	void build();
+
+	// Need to implement this virtual function from parent class
+	std::pair<double,double> get_input_space(int dim) const {return fullmodel.get_input_space(dim);}
+
+private:
+	Parallel & par;				// Reference to parallel object
+	ForwardModel & fullmodel;	// Reference to a FULL forward model
+
+	struct ComponentGrid {
+		std::vector<unsigned int>	levels;	// level in each dimension
+		std::vector<std::size_t>	sizes;	// # of points in each dimension (2^l-1)
+		std::vector<std::size_t>	strides;// position offset of the next point in each dimension
+		double 						coeff;	// combination coefficient
+		std::vector<double>			values;	// num_points-by-output_size, row-major, last dimension fastest
+	};
+	std::vector<ComponentGrid> grids;
+	std::size_t level = 0;
+
+	// Full model data of all points computed so far (reused when level increases)
+	std::map< std::vector<uint32_t>, std::vector<double> > point_data;
+
+private:
+	void create_component_grids();
+
+	void add_levels(
+			std::vector<unsigned int>& levels,
+			std::size_t dim,
+			unsigned int remaining,
+			double coeff);
+
+	std::vector<uint32_t> get_point_key(
+			ComponentGrid const& g,
+			std::size_t pos);
+
+	std::vector<double> get_point_coord(std::vector<uint32_t> const& key);
+
+	void compute_points(std::vector< std::vector<uint32_t> > const& keys);
+};
+#endif /* SURROGATE_SGCT_HPP_ */
@@ -33,6 +33,63 @@ SGI::SGI(
 	eval = nullptr;
 	bbox = nullptr;
 	seq_maxpos = make_pair(0, 0.0);
+	is_logpos = cfg.get_param_bool("sgi_is_logpos");
+	is_pod = cfg.get_param_bool("sgi_is_pod");
+	string strategy = cfg.get_param_string("sgi_refine_strategy");
+	if ((strategy != "spatial") && (strategy != "dimension")) {
+		par.info();
+		printf("ERROR: SGI refine strategy %s is not supported (spatial|dimension). Program abort!\n", strategy.c_str());
+		exit(EXIT_FAILURE);
+	}
+	string basis = cfg.get_param_string("sgi_basis");
+	if ((basis != "modlinear") && (basis != "modbspline")) {
+		par.info();
+		printf("ERROR: SGI basis %s is not supported (modlinear|modbspline). Program abort!\n", basis.c_str());
+		exit(EXIT_FAILURE);
+	}
+	// Distributed alphas are packed from the private double precision alphas
+	if (cfg.get_param_bool("sgi_is_distributed") &&
+			((basis != "modlinear") || cfg.get_param_bool("sgi_is_shared") ||
+			(cfg.get_param_string("sgi_alpha_precision") != "double"))) {
+		par.info();
+		printf("ERROR: SGI distributed surrogate needs modlinear basis, no sgi_is_shared and sgi_alpha_precision double. Program abort!\n");
+		exit(EXIT_FAILURE);
+	}
+	string estimator = cfg.get_param_string("sgi_error_estimator");
+	if ((estimator != "test") && (estimator != "surplus") && (estimator != "surplus_pos")) {
+		par.info();
+		printf("ERROR: SGI error estimator %s is not supported (test|surplus|surplus_pos). Program abort!\n", estimator.c_str());
+		exit(EXIT_FAILURE);
+	}
+	// B-spline surpluses come from a coupled solve, they are not local interpolation errors
+	if ((basis == "modbspline") && (estimator != "test")) {
+		par.info();
+		printf("ERROR: SGI error estimator %s needs modlinear basis, use test with modbspline. Program abort!\n", estimator.c_str());
+		exit(EXIT_FAILURE);
+	}
+	if (cfg.get_param_bool("sgi_is_pipelined") && (estimator != "test")) {
+		par.info();
+		printf("ERROR: SGI pipelined build needs sgi_error_estimator test. Program abort!\n");
+		exit(EXIT_FAILURE);
+	}
+	// SPMD: MASTER computes its own share after the check, the other ranks wait for it anyway
+	if (cfg.get_param_bool("sgi_is_pipelined") && !cfg.get_param_bool("sgi_is_masterworker")) {
+		par.info();
+		printf("ERROR: SGI pipelined build needs sgi_is_masterworker yes. Program abort!\n");
+		exit(EXIT_FAILURE);
+	}
+	string precision = cfg.get_param_string("sgi_alpha_precision");
+	if ((precision != "double") && (precision != "single")) {
+		par.info();
+		printf("ERROR: SGI alpha precision %s is not supported (double|single). Program abort!\n", precision.c_str());
+		exit(EXIT_FAILURE);
+	}
+	// The compiled evaluator holds the double precision alphas, single precision would never be used
+	if ((cfg.get_param_string("sgi_eval_lib") != "") && (precision != "double")) {
+		par.info();
+		printf("ERROR: SGI compiled evaluator needs sgi_alpha_precision double. Program abort!\n");
+		exit(EXIT_FAILURE);
+	}
 #if (IMPI==1)
 	impi_gpoffset = 0;
 #endif
@@ -42,22 +99,156 @@ vector<double> SGI::run(
 		vector<double> const& m)
 {
 	// Grid check
-	if (!eval) {
+	if (!eval && !is_distributed) {
 		par.info();
 		printf("ERROR: SGI::run fail because surrogate is not properly built. Program abort!\n");
 		exit(EXIT_FAILURE);
 	}
-	// Convert m into DataVector
-	DataVector point (m);
-	// Evaluate m
 	std::size_t output_size = cfg.get_output_size();
 	vector<double> d (output_size);
+	if (aot_eval) {
+		aot_eval(&m[0], &d[0]);
+		return d;
+	}
+	if (is_distributed) {
+		// Collective: every rank adds the partial sums of its own subspaces
+		vector<double> z (packed_cols);
+		eval_distributed(m, DIST_RUN, z.data());
+		if (is_pod) {
+			Eigen::Map<Eigen::VectorXd> (&d[0], output_size) =
+					pod_mean + pod_basis * Eigen::Map<Eigen::VectorXd>(z.data(), packed_num_alphas);
+		} else {
+			std::copy(z.begin(), z.begin() + output_size, d.begin());
+		}
+		return d;
+	}
+	if (is_shared || is_sp) {
+		// Evaluate from the reduced (node-shared and/or single precision) alphas
+		if (is_pod) {
+			Eigen::VectorXd z (packed_num_alphas);
+			eval_affected(m, 0, packed_num_alphas, z.data());
+			Eigen::Map<Eigen::VectorXd> (&d[0], output_size) = pod_mean + pod_basis * z;
+		} else {
+			eval_affected(m, 0, output_size, &d[0]);
+		}
+		return d;
+	}
+	// Convert m into DataVector
+	DataVector point = get_eval_point(m);
+	// Evaluate m
+	if (is_pod) {
+		// Interpolate POD coefficients, then reconstruct: d = mean + basis * z
+		Eigen::VectorXd z (alphas.size());
+		for (std::size_t k=0; k < alphas.size(); k++) {
+			z(k) = eval->eval(alphas[k], point);
+		}
+		Eigen::Map<Eigen::VectorXd> (&d[0], output_size) = pod_mean + pod_basis * z;
+		return d;
+	}
 	for (std::size_t j=0; j < output_size; j++) {
 		d[j] = eval->eval(alphas[j], point);
 	}
 	return d;
 }
 
+double SGI::compute_posterior(
+		vector<double> const& m)
+{
+	if (!is_logpos) return ForwardModel::compute_posterior(m);
+	// Grid check
+	if (!eval && !is_distributed) {
+		par.info();
+		printf("ERROR: SGI::compute_posterior fail because surrogate is not properly built. Program abort!\n");
+		exit(EXIT_FAILURE);
+	}
+	// Evaluate the log-posterior surrogate only
+	// NOTE: posterior is in (0, 1] by definition, so clip interpolation overshoots at 0
+	double logpos;
+	if (aot_logpos) {
+		logpos = aot_logpos(&m[0]);
+	} else if (is_distributed) {
+		eval_distributed(m, DIST_LOGPOS, &logpos);
+	} else if (is_shared || is_sp) {
+		eval_affected(m, packed_num_alphas, 1, &logpos);
+	} else {
+		DataVector point = get_eval_point(m);
+		logpos = eval->eval(alpha_logpos, point);
+	}
+	return exp(fmin(0.0, logpos));
+}
+
+void SGI::compute_posterior_batch(
+		vector<double> const& ms,
+		std::size_t n,
+		double* pos)
+{
+	// Compiled and distributed evaluators are point-wise (distributed: one collective round per point)
+	if (aot_eval || is_distributed) {
+		ForwardModel::compute_posterior_batch(ms, n, pos);
+		return;
+	}
+	// Grid check
+	if (!eval) {
+		par.info();
+		printf("ERROR: SGI::compute_posterior_batch fail because surrogate is not properly built. Program abort!\n");
+		exit(EXIT_FAILURE);
+	}
+	std::size_t input_size = cfg.get_input_size();
+	std::size_t output_size = cfg.get_output_size();
+	// Reduced (shared/single precision) alphas leave alphas empty
+	std::size_t num_alphas = (is_shared || is_sp) ? packed_num_alphas : alphas.size();
+	vector<double> m (input_size);
+	vector<double> z (num_alphas);
+	vector<double> d (output_size);
+	for (std::size_t c=0; c < n; c++) {
+		for (std::size_t k=0; k < input_size; k++) m[k] = ms[k*n + c];
+		// One grid traversal per point, instead of one per output (the log-posterior column follows the alphas)
+		if (is_logpos) {
+			double logpos;
+			eval_affected(m, num_alphas, 1, &logpos);
+			pos[c] = exp(fmin(0.0, logpos));
+			continue;
+		}
+		eval_affected(m, 0, num_alphas, z.data());
+		if (is_pod) {
+			Eigen::Map<Eigen::VectorXd> (&d[0], output_size) =
+					pod_mean + pod_basis * Eigen::Map<Eigen::VectorXd>(z.data(), num_alphas);
+		} else {
+			std::copy(z.begin(), z.begin() + output_size, d.begin());
+		}
+		pos[c] = cfg.compute_posterior(d);
+	}
+	return;
+}
+
+void SGI::check_posterior_batch(std::size_t num_points)
+{
+	// Distributed evaluation is point-wise (and collective) in both paths
+	if (is_distributed || num_points == 0) return;
+	std::size_t input_size = cfg.get_input_size();
+	RandomStream rng (RNG_STREAM_SGI);
+	vector<double> ms (input_size * num_points);
+	for (std::size_t i=0; i < input_size; i++) {
+		pair<double,double> range = get_input_space(i);
+		for (std::size_t c=0; c < num_points; c++)
+			ms[i*num_points + c] = rng.uniform(range.first, range.second);
+	}
+	vector<double> pos (num_points);
+	compute_posterior_batch(ms, num_points, &pos[0]);
+	vector<double> m (input_size);
+	for (std::size_t c=0; c < num_points; c++) {
+		for (std::size_t i=0; i < input_size; i++) m[i] = ms[i*num_points + c];
+		double p = compute_posterior(m);
+		if (!(fabs(pos[c] - p) <= 1e-12 + 1e-9 * fabs(p))) {
+			par.info();
+			printf("ERROR: SGI batched posterior %.12e differs from point-wise posterior %.12e at %s. Program abort!\n",
+					pos[c], p, tools::sample_to_string(m).c_str());
+			exit(EXIT_FAILURE);
+		}
+	}
+	return;
+}
+
 void SGI::build()
 {
 	// Get config variables
@@ -69,6 +260,12 @@ void SGI::build()
 	// find out whether it's grid initialization or refinement
 	bool is_init = (!this->eval) ? true : false;
 	std::size_t num_points;
+	// Refinement needs private double precision alphas (compiled evaluator is outdated)
+	aot_eval = nullptr;
+	aot_logpos = nullptr;
+	undistribute_alphas();
+	unshare_alphas();
+	restore_precision();
 
 #if (IMPI==1)
 	if (par.status == MPI_ADAPT_STATUS_JOINING) {
@@ -77,10 +274,11 @@ void SGI::build()
 #endif
 		if (is_init) {
 			if (cfg.get_param_string("sgi_resume_path") != "") {
+				// data of an interrupted phase must be read before resume() overwrites files
+				load_journal();
 				// for resuming a job, grid and data, pos are loaded from files
 				// therefore, no need for build grid computation, return immediately
-				resume();
-				return; 
+				if (resume()) return;
 			}
 			if (par.is_master()) {
 				fflush(NULL);
@@ -88,7 +286,7 @@ void SGI::build()
 				printf("SGI: Initializing SGI surrogate...\n");
 			}
 			// 1. All: Construct grid
-			grid.reset(Grid::createModLinearGrid(input_size).release()); // create empty grid
+			grid.reset(create_grid()); // create empty grid
 			grid->getGenerator().regular(init_level); // populate grid points
 			bbox.reset(create_boundingbox());
 			grid->setBoundingBox(*bbox); // set up bounding box
@@ -102,8 +300,18 @@ void SGI::build()
 			}
 			// 1. All: refine grid
 			impi_gpoffset = grid->getSize(); // STAYING ranks set this variable needed by the JOINING ranks
-			refine_grid_bcast(refine_portion); // MASTER refine then bcast
+			if (cfg.get_param_string("sgi_refine_strategy") == "dimension") {
+				refine_grid_bcast_aniso(refine_portion); // MASTER refine (anisotropic) then bcast
+			} else {
+				refine_grid_bcast(refine_portion); // MASTER refine then bcast
+			}
 			num_points = grid->getSize();
+			// Pipelined: zero surpluses at the new points keep the surrogate of the previous phase
+			// (basis functions of the old points do not change), so phase_check can evaluate it
+			if (phase_check) {
+				for (auto& a: alphas) a.resize(num_points, 0.0);
+				if (is_logpos) alpha_logpos.resize(num_points, 0.0);
+			}
 
 #if (SGI_DEBUG==1) //Debug only: to check if bcast grid correct
 			int src_rank = par.size - 1;
@@ -120,12 +328,24 @@ void SGI::build()
 #endif
 		}
 		if (par.is_master()) mpiio_write_grid(); // MASTER write grid
+		prepare_journal(impi_gpoffset); // skip points computed by an interrupted job
 #if (IMPI==1)
 	}
 #endif
+	std::size_t prev_est_offset = est_offset;
+	std::pair<std::size_t, double> prev_maxpos = seq_maxpos;
+	est_offset = impi_gpoffset;
 	// 2. All: Compute data at each grid point (result written to MPI IO file)
 	//		and find the top maxpos points
 	compute_grid_points(impi_gpoffset, is_masterworker);
+	gp_done.clear();
+	// Pipelined: previous phase converged, drop this one
+	if (is_phase_stop) {
+		seq_maxpos = prev_maxpos;
+		est_offset = prev_est_offset;
+		discard_refinement(impi_gpoffset);
+		return;
+	}
 	// 3. All: Compute and hierarchize alphas
 	compute_hier_alphas();
 	// 4. Update op_eval
@@ -142,14 +362,753 @@ void SGI::build()
 			printf("SGI: Refine SGI surrogate successful.\n");
 			printf("==========================================\n");
 		}
-
 		// Make a copy of data files
-		string cmd = "cp " + cfg.get_grid_fname() + " " + cfg.get_grid_bak_fname();
-		system(cmd.c_str());	
-		cmd = "cp " + cfg.get_data_fname() + " " + cfg.get_data_bak_fname();
-		system(cmd.c_str());	
-		cmd = "cp " + cfg.get_pos_fname() + " " + cfg.get_pos_bak_fname();
-		system(cmd.c_str());	
+		backup_files();
+	}
+	return;
+}
+
+/**
+ * Pipelined build phase: while the points of the next refinement are computed, MASTER checks the
+ * current surrogate with is_converged() (in master-worker mode MASTER only dispatches jobs anyway).
+ * If it converged, remaining jobs are not dispatched and the refinement is discarded.
+ */
+bool SGI::build_pipelined(std::function<bool()> const& is_converged)
+{
+	if (!this->eval) {
+		build(); // nothing to check before the initial grid
+		return false;
+	}
+	phase_check = is_converged;
+	build();
+	phase_check = nullptr;
+	bool is_stop = is_phase_stop;
+	is_phase_stop = false;
+	return is_stop;
+}
+
+/**
+ * Remove the points added by the last refinement (they are at the end of the storage)
+ */
+void SGI::discard_refinement(std::size_t gp_offset)
+{
+	std::size_t num_gps = grid->getSize();
+	GridStorage& storage = grid->getStorage();
+	while (storage.getSize() > gp_offset)
+		storage.deleteLast();
+	storage.recalcLeafProperty();
+	for (auto& a: alphas) a.resize(gp_offset);
+	if (is_logpos) alpha_logpos.resize(gp_offset);
+	eval.reset(sgpp::op_factory::createOperationEval(*grid).release());
+	if (par.is_master()) {
+		mpiio_write_grid(); // data/pos beyond gp_offset are ignored
+		fflush(NULL);
+		printf("SGI: previous phase converged, discarded %lu new gps\n", num_gps-gp_offset);
+		printf("==========================================\n");
+	}
+	return;
+}
+
+/**
+ * The surplus of a newly added point x is f(x) - g_old(x), i.e. the error of the surrogate of the
+ * previous build phase at x. With the error measure of ErrorAnalysis this gives
+ *     err(x) = |alpha(x)| / |2 f(x) - alpha(x)|   (clamped to [0, 1])
+ * averaged over the points added by the last refinement, or for an initial/resumed grid over the
+ * points of the finest level sum. With is_weighted, the average is weighted by the posterior.
+ * All ranks work on a contiguous share of these points, data and posteriors are read from files.
+ */
+double SGI::estimate_error(bool is_weighted)
+{
+	if (alphas.empty()) {
+		par.info();
+		printf("ERROR: SGI error estimate needs private alphas. Program abort!\n");
+		exit(EXIT_FAILURE);
+	}
+	std::size_t output_size = cfg.get_output_size();
+	std::size_t num_gps = grid->getSize();
+	GridStorage& storage = grid->getStorage();
+	// Points of the last build phase
+	vector<std::size_t> seqs;
+	if (est_offset > 0 && est_offset < num_gps) {
+		for (std::size_t i=est_offset; i < num_gps; i++) seqs.push_back(i);
+	} else {
+		unsigned int max_sum = 0;
+		vector<unsigned int> level_sums (num_gps);
+		for (std::size_t i=0; i < num_gps; i++) {
+			level_sums[i] = storage.get(i)->getLevelSum();
+			max_sum = std::max(max_sum, level_sums[i]);
+		}
+		for (std::size_t i=0; i < num_gps; i++)
+			if (level_sums[i] == max_sum) seqs.push_back(i);
+	}
+	// Contiguous share of this rank
+	std::size_t first = seqs.size() * par.rank / par.size;
+	std::size_t last = seqs.size() * (par.rank+1) / par.size;
+	// sums[0]: error, sums[1]: weighted error, sums[2]: weights
+	double sums[3] = {0.0, 0.0, 0.0};
+	if (first < last) {
+		std::size_t seq_min = seqs[first];
+		std::size_t seq_max = seqs[last-1];
+		unique_ptr<double[]> data (new double[(seq_max-seq_min+1) * output_size]);
+		unique_ptr<double[]> pos (new double[seq_max-seq_min+1]);
+		mpiio_readwrite_data(true, seq_min, seq_max, data.get());
+		mpiio_readwrite_pos(true, seq_min, seq_max, pos.get());
+		std::size_t num_alphas = (is_shared || is_sp) ? packed_num_alphas : alphas.size();
+		Eigen::VectorXd z (num_alphas);
+		vector<double> r (output_size);
+		for (std::size_t k=first; k < last; k++) {
+			std::size_t i = seqs[k];
+			const double* f = &data[(i-seq_min)*output_size];
+			// Surplus in output space (POD: the mean is interpolated exactly)
+			if (is_pod) {
+				for (std::size_t j=0; j < num_alphas; j++) z(j) = alphas[j][i];
+				Eigen::VectorXd rz = pod_basis * z;
+				for (std::size_t j=0; j < output_size; j++) r[j] = rz(j);
+			} else {
+				for (std::size_t j=0; j < output_size; j++) r[j] = alphas[j][i];
+			}
+			double num = 0.0, denom = 0.0;
+			for (std::size_t j=0; j < output_size; j++) {
+				num += r[j] * r[j];
+				denom += (2.0*f[j] - r[j]) * (2.0*f[j] - r[j]);
+			}
+			double err = (denom == 0.0) ? 0.0 : sqrt(num/denom);
+			if (std::isnan(err) || std::isinf(err) || err > 1.0) err = 1.0;
+			double w = (std::isnan(pos[i-seq_min]) || pos[i-seq_min] < 0.0) ? 0.0 : pos[i-seq_min];
+			sums[0] += err;
+			sums[1] += w * err;
+			sums[2] += w;
+		}
+	}
+	MPI_Allreduce(MPI_IN_PLACE, sums, 3, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+	// All posteriors vanish: fall back to the plain average
+	double err = (is_weighted && sums[2] > 0.0) ? sums[1]/sums[2] : sums[0]/double(seqs.size());
+	if (par.is_master()) {
+		fflush(NULL);
+		printf("SGI: estimated error %.8f from %lu %s\n", err, seqs.size(),
+				(is_weighted && sums[2] > 0.0) ? "posterior-weighted surpluses" : "surpluses");
+	}
+	return err;
+}
+
+/**
+ * Coarsening: remove grid points whose surpluses are negligible for ALL outputs.
+ * Only MASTER coarsens the grid, then bcast it (same reason as refine_grid_bcast).
+ *
+ * Coarsening indicator of point i: c_i = max_j ( |alpha_j[i]| / max_k |alpha_j[k]| ),
+ * i.e. surpluses are normalized per output, so every output counts equally.
+ * Only leaves can be removed, therefore coarsening is repeated until no more points go.
+ *
+ * NOTE: data files are NOT touched here, call coarsen_finalize() to accept or reject.
+ */
+std::size_t SGI::coarsen(double threshold)
+{
+#if (SGI_PRINT_TIMER==1)
+	double tic = MPI_Wtime();
+#endif
+	aot_eval = nullptr;
+	aot_logpos = nullptr;
+	undistribute_alphas();
+	unshare_alphas();
+	restore_precision();
+	est_offset = 0;
+	std::size_t num_gps = grid->getSize();
+	std::size_t new_num_gps;
+
+	// B-spline coefficients are coupled (removing a point changes all others), skip
+	if (grid->getType() == GridType::ModBspline) {
+		if (par.is_master()) {
+			fflush(NULL);
+			printf("SGI: coarsening is only supported for modlinear basis, skipped.\n");
+		}
+		coarsen_remaining.resize(num_gps);
+		for (std::size_t i=0; i < num_gps; i++)
+			coarsen_remaining[i] = i;
+		return 0;
+	}
+
+	if (par.is_master()) {
+		fflush(NULL);
+		printf("==========================================\n");
+		printf("SGI: Coarsening SGI surrogate...\n");
+		// Compute coarsening indicator for each gp
+		vector<double> alpha_max (alphas.size());
+		for (std::size_t j=0; j < alphas.size(); j++)
+			alpha_max[j] = alphas[j].maxNorm();
+		vector<double> indicator (num_gps, 0.0);
+		for (std::size_t i=0; i < num_gps; i++) {
+			for (std::size_t j=0; j < alphas.size(); j++) {
+				if (alpha_max[j] > 0.0)
+					indicator[i] = fmax(indicator[i], fabs(alphas[j][i]) / alpha_max[j]);
+			}
+		}
+		// Never remove the maxpos grid point
+		indicator[seq_maxpos.first] = 1.0;
+		// Keep track of which (pre-coarsening) seq the remaining points have
+		DataVector remain (num_gps);
+		for (std::size_t i=0; i < num_gps; i++)
+			remain[i] = double(i);
+		// Coarsen until no more leaves can be removed
+		std::size_t num_removable;
+		do {
+			new_num_gps = grid->getSize();
+			DataVector c (new_num_gps);
+			num_removable = 0;
+			for (std::size_t i=0; i < new_num_gps; i++) {
+				c[i] = indicator[std::size_t(remain[i])];
+				if (c[i] <= threshold) num_removable++;
+			}
+			if (num_removable < 1) break;
+			SurplusCoarseningFunctor func (c, num_removable, threshold);
+			grid->getGenerator().coarsen(func, remain); // remain gets restructured
+		} while (grid->getSize() < new_num_gps);
+		new_num_gps = grid->getSize();
+		coarsen_remaining.resize(new_num_gps);
+		for (std::size_t i=0; i < new_num_gps; i++)
+			coarsen_remaining[i] = std::size_t(remain[i]);
+	}
+	// Bcast the grid and the remaining seqs
+	bcast_grid(MPI_COMM_WORLD);
+	new_num_gps = grid->getSize();
+	coarsen_remaining.resize(new_num_gps);
+	MPI_Bcast(&coarsen_remaining[0], new_num_gps, MPI_SIZE_T, par.master, MPI_COMM_WORLD);
+
+	// All: drop the removed points from alphas (surpluses of the remaining points do not change)
+	for (std::size_t j=0; j < alphas.size(); j++)
+		alphas[j].restructure(coarsen_remaining);
+	if (is_logpos)
+		alpha_logpos.restructure(coarsen_remaining);
+	// All: update maxpos seq
+	seq_maxpos.first = std::find(coarsen_remaining.begin(), coarsen_remaining.end(),
+			seq_maxpos.first) - coarsen_remaining.begin();
+	eval.reset(sgpp::op_factory::createOperationEval(*grid).release());
+
+	if (par.is_master()) {
+		fflush(NULL);
+		printf("SGI: total %zu gps, %zu removed, threshold %.6f\n",
+				new_num_gps, num_gps-new_num_gps, threshold);
+#if (SGI_PRINT_TIMER==1)
+		printf("SGI: coarsened grid in %.6f seconds.\n", MPI_Wtime()-tic);
+#endif
+	}
+	return num_gps - new_num_gps;
+}
+
+void SGI::coarsen_finalize(bool is_accept)
+{
+	if (is_accept) {
+		// Master rewrites grid, data, and pos files for the coarsened grid
+		if (par.is_master()) {
+			std::size_t output_size = cfg.get_output_size();
+			std::size_t num_gps = grid->getSize();
+			// coarsen_remaining is sorted, only need to read up to its last entry
+			std::size_t old_num_gps = coarsen_remaining.back() + 1;
+			unique_ptr<double[]> data (new double[output_size * old_num_gps]);
+			unique_ptr<double[]> pos (new double[old_num_gps]);
+			mpiio_readwrite_data(true, 0, old_num_gps-1, data.get());
+			mpiio_readwrite_pos(true, 0, old_num_gps-1, pos.get());
+			// Pack remaining points to the front (in place, since coarsen_remaining[i] >= i)
+			for (std::size_t i=0; i < num_gps; i++) {
+				std::copy(&data[coarsen_remaining[i]*output_size],
+						&data[coarsen_remaining[i]*output_size] + output_size, &data[i*output_size]);
+				pos[i] = pos[coarsen_remaining[i]];
+			}
+			// Remove old files, so no stale data is left behind
+			MPI_File_delete(cfg.get_grid_fname().c_str(), MPI_INFO_NULL);
+			MPI_File_delete(cfg.get_data_fname().c_str(), MPI_INFO_NULL);
+			MPI_File_delete(cfg.get_pos_fname().c_str(), MPI_INFO_NULL);
+			mpiio_write_grid();
+			mpiio_readwrite_data(false, 0, num_gps-1, data.get());
+			mpiio_readwrite_pos(false, 0, num_gps-1, pos.get());
+			backup_files();
+			fflush(NULL);
+			printf("SGI: Coarsen SGI surrogate accepted.\n");
+			printf("==========================================\n");
+		}
+	} else {
+		// All: restore grid and alphas from files (files still hold the pre-coarsening grid)
+		seq_maxpos.first = coarsen_remaining[seq_maxpos.first];
+		mpiio_read_grid();
+		compute_hier_alphas();
+		if (par.is_master()) {
+			fflush(NULL);
+			printf("SGI: Coarsen SGI surrogate rejected, grid restored.\n");
+			printf("==========================================\n");
+		}
+	}
+	coarsen_remaining.clear();
+	MPI_Barrier(MPI_COMM_WORLD);
+	return;
+}
+
+/**
+ * MPI-3 shared memory: the first rank of each node allocates one window for all alphas,
+ * the other ranks on the node only map it. After this, run() and compute_posterior() read
+ * the (read-only) shared copy and the private alphas are freed.
+ * NOTE: grid storage (SGpp hash map) stays private, it is small compared to the alphas.
+ */
+void SGI::share_alphas()
+{
+	if (is_shared) return;
+	std::size_t num_gps = grid->getSize();
+	if (!is_sp) {
+		packed_num_alphas = alphas.size();
+		packed_cols = packed_num_alphas + (is_logpos ? 1 : 0);
+	}
+	int elem_size = is_sp ? sizeof(float) : sizeof(double);
+	MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, par.rank, MPI_INFO_NULL, &node_comm);
+	int node_rank;
+	MPI_Comm_rank(node_comm, &node_rank);
+	MPI_Aint bytes = (node_rank == 0) ? num_gps * packed_cols * elem_size : 0;
+	void* buff;
+	if (MPI_Win_allocate_shared(bytes, elem_size, MPI_INFO_NULL, node_comm, &buff, &shared_win)
+			!= MPI_SUCCESS) {
+		par.info();
+		printf("ERROR: fail to allocate shared window for SGI alphas. Program abort!\n");
+		exit(EXIT_FAILURE);
+	}
+	if (node_rank == 0) {
+		for (std::size_t i=0; i < num_gps; i++) {
+			if (is_sp) {
+				for (std::size_t j=0; j < packed_cols; j++)
+					static_cast<float*>(buff)[i*packed_cols + j] = alphas_sp[j][i];
+			} else {
+				for (std::size_t j=0; j < packed_num_alphas; j++)
+					static_cast<double*>(buff)[i*packed_cols + j] = alphas[j][i];
+				if (is_logpos) static_cast<double*>(buff)[i*packed_cols + packed_num_alphas] = alpha_logpos[i];
+			}
+		}
+	} else {
+		MPI_Aint size;
+		int disp_unit;
+		MPI_Win_shared_query(shared_win, 0, &size, &disp_unit, &buff);
+	}
+	MPI_Win_fence(0, shared_win); // node root finished writing
+	// Free private copies
+	if (is_sp) {
+		shared_alphas_sp = static_cast<const float*>(buff);
+		vector<DataVectorSP>().swap(alphas_sp);
+	} else {
+		shared_alphas = static_cast<const double*>(buff);
+		vector<DataVector>().swap(alphas);
+		alpha_logpos = DataVector();
+	}
+	is_shared = true;
+	// Report memory and number of nodes
+	int is_node_root = (node_rank == 0) ? 1 : 0;
+	int num_nodes = 0;
+	MPI_Reduce(&is_node_root, &num_nodes, 1, MPI_INT, MPI_SUM, par.master, MPI_COMM_WORLD);
+	if (par.is_master()) {
+		fflush(NULL);
+		printf("SGI: shared alphas (%.3f MB per node) on %d node(s)\n",
+				double(num_gps * packed_cols * elem_size) / 1048576.0, num_nodes);
+	}
+	return;
+}
+
+void SGI::unshare_alphas()
+{
+	if (!is_shared) return;
+	std::size_t num_gps = grid->getSize();
+	if (is_sp) {
+		alphas_sp.assign(packed_cols, DataVectorSP(num_gps));
+		for (std::size_t j=0; j < packed_cols; j++)
+			for (std::size_t i=0; i < num_gps; i++)
+				alphas_sp[j].set(i, shared_alphas_sp[i*packed_cols + j]);
+	} else {
+		alphas.resize(packed_num_alphas);
+		for (std::size_t j=0; j < packed_num_alphas; j++) {
+			alphas[j].resize(num_gps);
+			for (std::size_t i=0; i < num_gps; i++)
+				alphas[j].set(i, shared_alphas[i*packed_cols + j]);
+		}
+		if (is_logpos) {
+			alpha_logpos.resize(num_gps);
+			for (std::size_t i=0; i < num_gps; i++)
+				alpha_logpos.set(i, shared_alphas[i*packed_cols + packed_num_alphas]);
+		}
+	}
+	free_shared();
+	return;
+}
+
+void SGI::free_shared()
+{
+	if (!is_shared) return;
+	shared_alphas = nullptr;
+	shared_alphas_sp = nullptr;
+	MPI_Win_free(&shared_win);
+	MPI_Comm_free(&node_comm);
+	is_shared = false;
+	return;
+}
+
+/**
+ * Surrogate evaluation is memory bound over the alphas: keep them in single precision
+ * (half of the bytes), products and sums are still computed in double.
+ */
+void SGI::reduce_precision()
+{
+	if (is_sp) return;
+	unshare_alphas();
+	std::size_t num_gps = grid->getSize();
+	packed_num_alphas = alphas.size();
+	packed_cols = packed_num_alphas + (is_logpos ? 1 : 0);
+	alphas_sp.assign(packed_cols, DataVectorSP(num_gps));
+	for (std::size_t j=0; j < packed_cols; j++) {
+		DataVector const& a = (j < packed_num_alphas) ? alphas[j] : alpha_logpos;
+		for (std::size_t i=0; i < num_gps; i++)
+			alphas_sp[j].set(i, static_cast<float>(a[i]));
+	}
+	// Free double precision copies
+	vector<DataVector>().swap(alphas);
+	alpha_logpos = DataVector();
+	is_sp = true;
+	return;
+}
+
+void SGI::restore_precision()
+{
+	if (!is_sp) return;
+	std::size_t num_gps = grid->getSize();
+	alphas.resize(packed_num_alphas);
+	for (std::size_t j=0; j < packed_cols; j++) {
+		DataVector& a = (j < packed_num_alphas) ? alphas[j] : alpha_logpos;
+		a.resize(num_gps);
+		for (std::size_t i=0; i < num_gps; i++)
+			a.set(i, alphas_sp[j][i]);
+	}
+	vector<DataVectorSP>().swap(alphas_sp);
+	is_sp = false;
+	return;
+}
+
+/**
+ * Subspaces (level vectors) are assigned to ranks, balanced by # of grid points. Each rank
+ * keeps only the grid points and alphas of its own subspaces (MASTER also keeps the full grid
+ * for refinement and maxpos). Evaluation is then collective (see eval_distributed).
+ */
+void SGI::distribute_alphas()
+{
+	if (is_distributed) return;
+	std::size_t input_size = cfg.get_input_size();
+	std::size_t num_gps = grid->getSize();
+	packed_num_alphas = alphas.size();
+	packed_cols = packed_num_alphas + (is_logpos ? 1 : 0);
+	// 1. Group grid points by subspace
+	GridStorage& storage = grid->getStorage();
+	map< vector<unsigned int>, vector<std::size_t> > subspaces;
+	vector<unsigned int> levels (input_size);
+	for (std::size_t i=0; i < num_gps; i++) {
+		for (std::size_t d=0; d < input_size; d++)
+			levels[d] = storage.get(i)->getLevel(d);
+		subspaces[levels].push_back(i);
+	}
+	// 2. Assign subspaces to the least loaded rank (all ranks compute the same assignment)
+	vector<std::size_t> load (par.size, 0);
+	dist_storage.reset(new GridStorage(input_size));
+	dist_levels.clear();
+	dist_alphas.clear();
+	dist_seqs.clear();
+	for (auto const& sub: subspaces) {
+		int owner = min_element(load.begin(), load.end()) - load.begin();
+		load[owner] += sub.second.size();
+		if (owner != par.rank) continue;
+		dist_levels.insert(dist_levels.end(), sub.first.begin(), sub.first.end());
+		for (auto seq: sub.second) {
+			HashGridIndex idx (*storage.get(seq));
+			dist_storage->insert(idx);
+			dist_seqs.push_back(seq);
+			for (std::size_t j=0; j < packed_num_alphas; j++)
+				dist_alphas.push_back(alphas[j][seq]);
+			if (is_logpos) dist_alphas.push_back(alpha_logpos[seq]);
+		}
+	}
+	// 3. Free replicated alphas and grid
+	vector<DataVector>().swap(alphas);
+	alpha_logpos = DataVector();
+	if (!par.is_master()) {
+		eval.reset();
+		grid.reset();
+	}
+	is_distributed = true;
+	if (par.is_master()) {
+		fflush(NULL);
+		printf("SGI: distributed %lu subspaces, %lu to %lu grid points per rank\n", subspaces.size(),
+				*min_element(load.begin(), load.end()), *max_element(load.begin(), load.end()));
+	}
+	return;
+}
+
+void SGI::undistribute_alphas()
+{
+	if (!is_distributed) return;
+	// 1. All gather global seqs and alphas of all local grid points
+	int count = dist_seqs.size();
+	vector<int> counts (par.size), displs (par.size, 0);
+	MPI_Allgather(&count, 1, MPI_INT, &counts[0], 1, MPI_INT, MPI_COMM_WORLD);
+	for (int r=1; r < par.size; r++)
+		displs[r] = displs[r-1] + counts[r-1];
+	std::size_t num_gps = displs.back() + counts.back();
+	vector<std::size_t> seqs (num_gps);
+	MPI_Allgatherv(&dist_seqs[0], count, MPI_SIZE_T,
+			&seqs[0], &counts[0], &displs[0], MPI_SIZE_T, MPI_COMM_WORLD);
+	for (int r=0; r < par.size; r++) {
+		counts[r] *= packed_cols;
+		displs[r] *= packed_cols;
+	}
+	vector<double> rows (num_gps * packed_cols);
+	MPI_Allgatherv(&dist_alphas[0], count*packed_cols, MPI_DOUBLE,
+			&rows[0], &counts[0], &displs[0], MPI_DOUBLE, MPI_COMM_WORLD);
+	// 2. MASTER still has the full grid
+	bcast_grid(MPI_COMM_WORLD);
+	alphas.assign(packed_num_alphas, DataVector(num_gps));
+	if (is_logpos) alpha_logpos.resize(num_gps);
+	for (std::size_t r=0; r < num_gps; r++) {
+		for (std::size_t j=0; j < packed_num_alphas; j++)
+			alphas[j].set(seqs[r], rows[r*packed_cols + j]);
+		if (is_logpos) alpha_logpos.set(seqs[r], rows[r*packed_cols + packed_num_alphas]);
+	}
+	dist_storage.reset();
+	vector<unsigned int>().swap(dist_levels);
+	vector<double>().swap(dist_alphas);
+	vector<std::size_t>().swap(dist_seqs);
+	is_distributed = false;
+	return;
+}
+
+void SGI::serve_distributed()
+{
+	if (!is_distributed) return;
+	while (eval_distributed(vector<double>(), DIST_IDLE, NULL)) {}
+	return;
+}
+
+/**
+ * Emit a self-contained C++ evaluator: dimension, grid points and alphas are compile-time
+ * constants, and all outputs are summed at once. Grid points are grouped by subspace; in each
+ * subspace only the basis function whose support contains x is evaluated (same mapping as
+ * eval_local), and its alphas row is found by binary search in the sorted subspace positions.
+ * Compile it into a shared library, e.g.
+ *     mpicxx -std=c++11 -O3 -march=native -shared -fPIC sgi_eval.cpp -o sgi_eval.so
+ * and set sgi_eval_lib to load it (see load_evaluator).
+ */
+void SGI::write_evaluator(string const& fname)
+{
+	if (!par.is_master()) return;
+	if (grid->getType() != GridType::ModLinear) {
+		par.info();
+		printf("WARNING: SGI evaluator export only supports modlinear basis, %s not written.\n", fname.c_str());
+		return;
+	}
+	// Tables are written from the private double precision alphas
+	if (is_shared || is_sp || is_distributed) {
+		par.info();
+		printf("ERROR: SGI evaluator export needs private double precision alphas. Program abort!\n");
+		exit(EXIT_FAILURE);
+	}
+	std::size_t input_size = cfg.get_input_size();
+	std::size_t output_size = cfg.get_output_size();
+	std::size_t num_gps = grid->getSize();
+	std::size_t num_alphas = alphas.size();
+	// Group grid points by subspace, ordered by their position inside the full subspace
+	GridStorage& storage = grid->getStorage();
+	HashGridIndex::level_type l;
+	HashGridIndex::index_type i;
+	map< vector<unsigned int>, map<uint64_t, std::size_t> > subspaces;
+	vector<unsigned int> levels (input_size);
+	for (std::size_t n=0; n < num_gps; n++) {
+		uint64_t pos = 0, stride = 1;
+		for (std::size_t d=0; d < input_size; d++) {
+			storage.get(n)->get(d, l, i);
+			levels[d] = l;
+			pos += ((i - 1) / 2) * stride;
+			stride <<= (l - 1);
+		}
+		subspaces[levels][pos] = n;
+	}
+	FILE* fp = fopen(fname.c_str(), "w");
+	if (fp == NULL) {
+		par.info();
+		printf("ERROR: fail to open %s for evaluator write. Program abort!\n", fname.c_str());
+		exit(EXIT_FAILURE);
+	}
+	fprintf(fp, "// SGI surrogate evaluator, generated by eBayes SGI::write_evaluator. Do not edit.\n");
+	fprintf(fp, "// Build: mpicxx -std=c++11 -O3 -march=native -shared -fPIC %s -o <lib>.so\n",
+			fname.substr(fname.find_last_of('/')+1).c_str());
+	fprintf(fp, "#include <algorithm>\n#include <cstddef>\n#include <cstdint>\n\nnamespace {\n");
+	fprintf(fp, "constexpr std::size_t D = %lu;\n", input_size);
+	fprintf(fp, "constexpr std::size_t N = %lu;\n", num_gps);
+	fprintf(fp, "constexpr std::size_t S = %lu;\n", subspaces.size());
+	fprintf(fp, "constexpr std::size_t K = %lu;\n", num_alphas);
+	fprintf(fp, "constexpr std::size_t OUT = %lu;\n", output_size);
+	// Domain
+	fprintf(fp, "constexpr double LOWER[D] = {");
+	for (std::size_t d=0; d < input_size; d++)
+		fprintf(fp, "%s%.17g", d ? ", " : "", bbox->getBoundary(d).leftBoundary);
+	fprintf(fp, "};\nconstexpr double UPPER[D] = {");
+	for (std::size_t d=0; d < input_size; d++)
+		fprintf(fp, "%s%.17g", d ? ", " : "", bbox->getBoundary(d).rightBoundary);
+	fprintf(fp, "};\n");
+	// Subspaces: level vector and first row, rows are sorted by position within each subspace
+	fprintf(fp, "constexpr uint32_t SUB_LEVEL[S][D] = {\n");
+	for (auto const& sub: subspaces) {
+		fprintf(fp, "\t{");
+		for (std::size_t d=0; d < input_size; d++)
+			fprintf(fp, "%s%u", d ? "," : "", sub.first[d]);
+		fprintf(fp, "},\n");
+	}
+	fprintf(fp, "};\nconstexpr std::size_t SUB_BEGIN[S+1] = {\n");
+	std::size_t row = 0;
+	for (auto const& sub: subspaces) {
+		fprintf(fp, "\t%lu,\n", row);
+		row += sub.second.size();
+	}
+	fprintf(fp, "\t%lu,\n};\nconstexpr uint64_t POS[N] = {\n", row);
+	for (auto const& sub: subspaces)
+		for (auto const& pt: sub.second)
+			fprintf(fp, "\t%luULL,\n", pt.first);
+	// Alphas, point-major in the same row order
+	fprintf(fp, "};\nconstexpr double ALPHA[N][K] = {\n");
+	for (auto const& sub: subspaces) {
+		for (auto const& pt: sub.second) {
+			fprintf(fp, "\t{");
+			for (std::size_t k=0; k < num_alphas; k++)
+				fprintf(fp, "%s%.17g", k ? "," : "", alphas[k][pt.second]);
+			fprintf(fp, "},\n");
+		}
+	}
+	fprintf(fp, "};\n");
+	if (is_logpos) {
+		fprintf(fp, "constexpr double LOGPOS[N] = {\n");
+		for (auto const& sub: subspaces)
+			for (auto const& pt: sub.second)
+				fprintf(fp, "\t%.17g,\n", alpha_logpos[pt.second]);
+		fprintf(fp, "};\n");
+	}
+	if (is_pod) {
+		fprintf(fp, "constexpr double POD_MEAN[OUT] = {\n");
+		for (std::size_t j=0; j < output_size; j++)
+			fprintf(fp, "\t%.17g,\n", pod_mean(j));
+		fprintf(fp, "};\nconstexpr double POD_BASIS[OUT][K] = {\n");
+		for (std::size_t j=0; j < output_size; j++) {
+			fprintf(fp, "\t{");
+			for (std::size_t k=0; k < num_alphas; k++)
+				fprintf(fp, "%s%.17g", k ? "," : "", pod_basis(j,k));
+			fprintf(fp, "},\n");
+		}
+		fprintf(fp, "};\n");
+	}
+	// Modified linear basis (same as SGpp LinearModifiedBasis), point scaling and subspace lookup
+	fprintf(fp, "%s", R"(
+inline double basis(uint32_t l, uint32_t i, double x) {
+	const double h_inv = static_cast<double>(1u << l);
+	if (l == 1) return 1.0;
+	if (i == 1) return (x <= 2.0 / h_inv) ? (2.0 - h_inv * x) : 0.0;
+	if (i == (1u << l) - 1) return (x >= 1.0 - 2.0 / h_inv) ? (h_inv * x - static_cast<double>(i) + 1.0) : 0.0;
+	const double v = 1.0 - ((h_inv * x > i) ? (h_inv * x - i) : (i - h_inv * x));
+	return (v > 0.0) ? v : 0.0;
+}
+
+// Scale to unit cube, false if m is outside of the domain (surrogate is 0 there)
+inline bool to_unit(const double* m, double* x) {
+	for (std::size_t d = 0; d < D; d++) {
+		if (m[d] < LOWER[d] || m[d] > UPPER[d]) return false;
+		x[d] = (m[d] - LOWER[d]) / (UPPER[d] - LOWER[d]);
+	}
+	return true;
+}
+
+// Row of the basis function of subspace s whose support contains x, N if it is not in the grid
+inline std::size_t locate(std::size_t s, const double* x, double& v) {
+	uint64_t pos = 0, stride = 1;
+	v = 1.0;
+	for (std::size_t d = 0; d < D; d++) {
+		const uint32_t l = SUB_LEVEL[s][d];
+		const uint32_t i = (x[d] >= 1.0) ? (1u << l) - 1 : 2 * static_cast<uint32_t>(x[d] * (1u << (l-1))) + 1;
+		v *= basis(l, i, x[d]);
+		if (v == 0.0) return N;
+		pos += ((i - 1) / 2) * stride;
+		stride <<= (l - 1);
+	}
+	const uint64_t* first = POS + SUB_BEGIN[s];
+	const uint64_t* last = POS + SUB_BEGIN[s+1];
+	const uint64_t* it = std::lower_bound(first, last, pos);
+	return (it != last && *it == pos) ? static_cast<std::size_t>(it - POS) : N;
+}
+} // namespace
+
+extern "C" {
+)");
+	fprintf(fp, "uint64_t sgi_aot_fingerprint() { return %luULL; }\n\n", get_alphas_fingerprint(get_grid_fingerprint()));
+	fprintf(fp, "%s", R"(void sgi_aot_eval(const double* m, double* out) {
+	double x[D];
+	double z[K] = {0.0};
+	if (to_unit(m, x)) {
+		for (std::size_t s = 0; s < S; s++) {
+			double v;
+			const std::size_t n = locate(s, x, v);
+			if (n == N) continue;
+			for (std::size_t k = 0; k < K; k++)
+				z[k] += v * ALPHA[n][k];
+		}
+	}
+)");
+	if (is_pod) {
+		fprintf(fp, "%s", R"(	for (std::size_t j = 0; j < OUT; j++) {
+		out[j] = POD_MEAN[j];
+		for (std::size_t k = 0; k < K; k++)
+			out[j] += POD_BASIS[j][k] * z[k];
+	}
+}
+)");
+	} else {
+		fprintf(fp, "\tfor (std::size_t k = 0; k < K; k++) out[k] = z[k];\n}\n");
+	}
+	if (is_logpos) {
+		fprintf(fp, "%s", R"(
+double sgi_aot_logpos(const double* m) {
+	double x[D];
+	double r = 0.0;
+	if (to_unit(m, x)) {
+		for (std::size_t s = 0; s < S; s++) {
+			double v;
+			const std::size_t n = locate(s, x, v);
+			if (n != N) r += v * LOGPOS[n];
+		}
+	}
+	return r;
+}
+)");
+	}
+	fprintf(fp, "} // extern \"C\"\n");
+	fclose(fp);
+	fflush(NULL);
+	printf("SGI: wrote compiled evaluator source to %s (%lu subspaces)\n", fname.c_str(), subspaces.size());
+	return;
+}
+
+void SGI::load_evaluator(string const& libname)
+{
+	aot_handle = dlopen(libname.c_str(), RTLD_NOW | RTLD_LOCAL);
+	if (!aot_handle) {
+		par.info();
+		printf("ERROR: fail to load SGI evaluator %s (%s). Program abort!\n", libname.c_str(), dlerror());
+		exit(EXIT_FAILURE);
+	}
+	auto fingerprint = reinterpret_cast<uint64_t (*)()>(dlsym(aot_handle, "sgi_aot_fingerprint"));
+	aot_eval = reinterpret_cast<void (*)(const double*, double*)>(dlsym(aot_handle, "sgi_aot_eval"));
+	aot_logpos = reinterpret_cast<double (*)(const double*)>(dlsym(aot_handle, "sgi_aot_logpos"));
+	// The evaluator must be generated from exactly this surrogate
+	if (!fingerprint || !aot_eval || (fingerprint() != get_alphas_fingerprint(get_grid_fingerprint())) || (is_logpos && !aot_logpos)) {
+		par.info();
+		printf("ERROR: SGI evaluator %s does not match the current surrogate. Program abort!\n", libname.c_str());
+		exit(EXIT_FAILURE);
+	}
+	if (!is_logpos) aot_logpos = nullptr;
+	if (par.is_master()) {
+		fflush(NULL);
+		printf("SGI: loaded compiled evaluator %s\n", libname.c_str());
 	}
 	return;
 }
@@ -161,57 +1120,420 @@ vector<double> SGI::get_maxpos()
 	return samplepos;
 }
 
-void SGI::resume()
+/**
+ * Returns false if the resume path has no finished phase (only a journal of an interrupted first phase)
+ */
+bool SGI::resume()
+{
+	// Prefer the single-file checkpoint, fall back to grid/data/pos backups
+	int is_ckpt = 0;
+	int is_bak = 0;
+	if (par.is_master()) {
+		is_ckpt = (access(cfg.get_ckpt_resume_fname().c_str(), R_OK) == 0) ? 1 : 0;
+		is_bak = (access(cfg.get_grid_resume_fname().c_str(), R_OK) == 0) ? 1 : 0;
+	}
+	MPI_Bcast(&is_ckpt, 1, MPI_INT, par.master, MPI_COMM_WORLD);
+	MPI_Bcast(&is_bak, 1, MPI_INT, par.master, MPI_COMM_WORLD);
+	est_offset = 0;
+	if (is_ckpt) {
+		resume_checkpoint();
+		return true;
+	}
+	if (!is_bak) return false;
+	if (par.is_master()) {
+		fflush(NULL);
+		printf("\n==========================================\n");
+		printf("SGI: Building SGI surrogate from file...\n");
+		// Make a copy of data files
+		string cmd = "cp " + cfg.get_grid_resume_fname() + " " + cfg.get_grid_fname();
+		system(cmd.c_str());	
+		cmd = "cp " + cfg.get_data_resume_fname() + " " + cfg.get_data_fname();
+		system(cmd.c_str());	
+		cmd = "cp " + cfg.get_pos_resume_fname() + " " + cfg.get_pos_fname();
+		system(cmd.c_str());	
+	}
+	MPI_Barrier(MPI_COMM_WORLD);
+	// Set: grid, eval, bbox
+	mpiio_read_grid();
+	// Set: alphas
+	compute_hier_alphas();
+	// Read posterior
+	std::size_t num_gps = grid->getSize();
+	unique_ptr<double[]> pos (new double[num_gps]);
+	mpiio_readwrite_pos(true, 0, num_gps-1, pos.get());
+
+	// Find maxpos, spmd style
+	std::size_t lmin, lmax;
+	mpispmd_get_local_range(0, num_gps-1, lmin, lmax);
+	// Each rank go through local portion to find local maxpos
+	seq_maxpos.first = 0;
+	seq_maxpos.second = 0.0;
+	for (std::size_t i=lmin; i <= lmax; ++i) {
+		if (pos[i] > seq_maxpos.second) {
+			seq_maxpos.first = i;
+			seq_maxpos.second = pos[i];
+		}
+	}
+	// Find global maxpos
+	mpispmd_find_global_maxpos();
+
+	if (par.is_master()) {
+		// Backup files and write checkpoint, so the output path can be resumed from as well
+		backup_files();
+		fflush(NULL);
+		printf("SGI: Build SGI surrogate from file successful.\n");
+		printf("==========================================\n\n");
+	}
+	return true;
+}
+
+
+/*********************************************
+ *       		 Private Methods
+ *********************************************/
+/**
+ * MASTER reads the journal of an interrupted job from the resume path, together with the data and
+ * posteriors of its finished points (the phase itself is identified by the grid fingerprint).
+ */
+void SGI::load_journal()
+{
+	if (!par.is_master()) return;
+	FILE* fp = fopen(cfg.get_journal_resume_fname().c_str(), "rb");
+	if (fp == NULL) return;
+	char magic[8];
+	uint64_t num_gps = 0;
+	bool is_ok = (fread(magic, 1, 8, fp) == 8) && (memcmp(magic, SGI_JOURNAL_MAGIC, 8) == 0) &&
+			(fread(&journal_fingerprint, sizeof(uint64_t), 1, fp) == 1) &&
+			(fread(&num_gps, sizeof(uint64_t), 1, fp) == 1);
+	if (is_ok) {
+		journal_done.assign(num_gps, 0);
+		fread(&journal_done[0], 1, num_gps, fp); // entries missing from the file stay 0
+	}
+	fclose(fp);
+	if (!is_ok || std::count(journal_done.begin(), journal_done.end(), 1) == 0) {
+		journal_done.clear();
+		return;
+	}
+	// Read data and posteriors now, resume() may overwrite data.mpibin in the same path
+	std::size_t output_size = cfg.get_output_size();
+	journal_data.assign(num_gps * output_size, 0.0);
+	journal_pos.assign(num_gps, 0.0);
+	std::size_t num_data = 0, num_pos = 0;
+	fp = fopen(cfg.get_data_partial_resume_fname().c_str(), "rb");
+	if (fp != NULL) {
+		num_data = fread(&journal_data[0], sizeof(double), num_gps * output_size, fp) / output_size;
+		fclose(fp);
+	}
+	fp = fopen(cfg.get_pos_partial_resume_fname().c_str(), "rb");
+	if (fp != NULL) {
+		num_pos = fread(&journal_pos[0], sizeof(double), num_gps, fp);
+		fclose(fp);
+	}
+	// Points without data in the files must be recomputed
+	for (std::size_t i=std::min(num_data, num_pos); i < num_gps; i++)
+		journal_done[i] = 0;
+	return;
+}
+
+/**
+ * Start the journal of a build phase. If the journal of an interrupted job belongs to the same grid,
+ * MASTER writes its finished points into the data files, and all ranks skip them (see gp_done).
+ */
+void SGI::prepare_journal(std::size_t gp_offset)
+{
+	std::size_t output_size = cfg.get_output_size();
+	std::size_t num_gps = grid->getSize();
+	std::size_t num_done = 0;
+	gp_done.assign(num_gps, 0);
+	if (par.is_master()) {
+		uint64_t fingerprint = get_grid_fingerprint();
+		if (!journal_done.empty() && (journal_fingerprint == fingerprint) && (journal_done.size() == num_gps)) {
+			for (std::size_t i=gp_offset; i < num_gps; i++) {
+				if (!journal_done[i]) continue;
+				// Write each contiguous range of finished points
+				std::size_t j = i;
+				while ((j+1 < num_gps) && journal_done[j+1]) j++;
+				mpiio_readwrite_data(false, i, j, &journal_data[i*output_size]);
+				mpiio_readwrite_pos(false, i, j, &journal_pos[i]);
+				for (std::size_t k=i; k <= j; k++) gp_done[k] = 1;
+				num_done += j-i+1;
+				i = j;
+			}
+			fflush(NULL);
+			printf("SGI: resumed interrupted phase, %lu of %lu gps already computed\n",
+					num_done, num_gps-gp_offset);
+		}
+		journal_done.clear();
+		journal_data.clear();
+		journal_pos.clear();
+		// New journal: points of previous phases and reused points are done
+		FILE* fp = fopen(cfg.get_journal_fname().c_str(), "wb");
+		if (fp == NULL) {
+			par.info();
+			printf("ERROR: fail to open %s for journal write. Program abort!\n", cfg.get_journal_fname().c_str());
+			exit(EXIT_FAILURE);
+		}
+		uint64_t header[2] = {fingerprint, num_gps};
+		vector<char> done (gp_done);
+		std::fill(done.begin(), done.begin()+gp_offset, 1);
+		fwrite(SGI_JOURNAL_MAGIC, 1, 8, fp);
+		fwrite(header, sizeof(uint64_t), 2, fp);
+		fwrite(&done[0], 1, num_gps, fp);
+		fclose(fp);
+	}
+	// Also keeps ranks from marking the journal before MASTER has written it
+	MPI_Bcast(&num_done, 1, MPI_SIZE_T, par.master, MPI_COMM_WORLD);
+	if (num_done > 0) {
+		MPI_Bcast(&gp_done[0], num_gps, MPI_CHAR, par.master, MPI_COMM_WORLD);
+	} else {
+		gp_done.clear();
+	}
+	return;
+}
+
+void SGI::backup_files()
+{
+	// Make a copy of data files
+	string cmd = "cp " + cfg.get_grid_fname() + " " + cfg.get_grid_bak_fname();
+	system(cmd.c_str());
+	cmd = "cp " + cfg.get_data_fname() + " " + cfg.get_data_bak_fname();
+	system(cmd.c_str());
+	cmd = "cp " + cfg.get_pos_fname() + " " + cfg.get_pos_bak_fname();
+	system(cmd.c_str());
+	write_checkpoint();
+	return;
+}
+
+/**
+ * MASTER writes the complete surrogate (grid, hierarchized alphas, data, pos, metadata)
+ * into one file. The file is first written to a temp file then renamed, so a crash never
+ * leaves a half-written checkpoint behind.
+ */
+void SGI::write_checkpoint()
+{
+#if (SGI_PRINT_TIMER==1)
+	double tic = MPI_Wtime();
+#endif
+	std::size_t output_size = cfg.get_output_size();
+	std::size_t num_gps = grid->getSize();
+	string sg_str = grid->serialize();
+	// raw data and posteriors are needed for further refinement after resume
+	unique_ptr<double[]> data (new double[output_size * num_gps]);
+	unique_ptr<double[]> pos (new double[num_gps]);
+	mpiio_readwrite_data(true, 0, num_gps-1, data.get());
+	mpiio_readwrite_pos(true, 0, num_gps-1, pos.get());
+
+	// Fill in header, every section is 8-byte aligned
+	auto align8 = [](uint64_t off) { return (off + 7) & ~uint64_t(7); };
+	SGICheckpointHeader h;
+	memset(&h, 0, sizeof(h));
+	strncpy(h.magic, SGI_CKPT_MAGIC, sizeof(h.magic));
+	h.version = SGI_CKPT_VERSION;
+	h.input_size = cfg.get_input_size();
+	h.output_size = output_size;
+	h.num_gps = num_gps;
+	h.num_alphas = alphas.size();
+	h.pod_rank = is_pod ? pod_basis.cols() : 0;
+	h.grid_type = static_cast<uint64_t>(grid->getType());
+	h.flags = (is_logpos ? SGI_CKPT_LOGPOS : 0) | (is_pod ? SGI_CKPT_POD : 0);
+	h.seq_maxpos = seq_maxpos.first;
+	h.maxpos = seq_maxpos.second;
+	h.grid_str_size = sg_str.size();
+	h.off_grid = align8(sizeof(h));
+	h.off_alphas = align8(h.off_grid + h.grid_str_size);
+	h.off_logpos = h.off_alphas + h.num_alphas * num_gps * sizeof(double);
+	h.off_pod_mean = h.off_logpos + (is_logpos ? num_gps : 0) * sizeof(double);
+	h.off_pod_basis = h.off_pod_mean + (is_pod ? output_size : 0) * sizeof(double);
+	h.off_data = h.off_pod_basis + output_size * h.pod_rank * sizeof(double);
+	h.off_pos = h.off_data + num_gps * output_size * sizeof(double);
+	h.file_size = h.off_pos + num_gps * sizeof(double);
+
+	string tmpfile = cfg.get_ckpt_fname() + ".tmp";
+	FILE* fp = fopen(tmpfile.c_str(), "wb");
+	if (fp == NULL) {
+		par.info();
+		printf("ERROR: fail to open %s for checkpoint write. Program abort!\n", tmpfile.c_str());
+		exit(EXIT_FAILURE);
+	}
+	const char zeros[8] = {0};
+	bool is_ok = (fwrite(&h, sizeof(h), 1, fp) == 1);
+	is_ok = is_ok && (fwrite(zeros, 1, h.off_grid - sizeof(h), fp) == h.off_grid - sizeof(h));
+	is_ok = is_ok && (fwrite(sg_str.data(), 1, h.grid_str_size, fp) == h.grid_str_size);
+	is_ok = is_ok && (fwrite(zeros, 1, h.off_alphas - h.off_grid - h.grid_str_size, fp)
+			== h.off_alphas - h.off_grid - h.grid_str_size);
+	for (std::size_t j=0; j < alphas.size(); j++)
+		is_ok = is_ok && (fwrite(alphas[j].getPointer(), sizeof(double), num_gps, fp) == num_gps);
+	if (is_logpos)
+		is_ok = is_ok && (fwrite(alpha_logpos.getPointer(), sizeof(double), num_gps, fp) == num_gps);
+	if (is_pod) {
+		is_ok = is_ok && (fwrite(pod_mean.data(), sizeof(double), output_size, fp) == output_size);
+		is_ok = is_ok && (fwrite(pod_basis.data(), sizeof(double), pod_basis.size(), fp)
+				== std::size_t(pod_basis.size()));
+	}
+	is_ok = is_ok && (fwrite(data.get(), sizeof(double), num_gps*output_size, fp) == num_gps*output_size);
+	is_ok = is_ok && (fwrite(pos.get(), sizeof(double), num_gps, fp) == num_gps);
+	is_ok = is_ok && (fflush(fp) == 0) && (fsync(fileno(fp)) == 0);
+	fclose(fp);
+	if (!is_ok || (rename(tmpfile.c_str(), cfg.get_ckpt_fname().c_str()) != 0)) {
+		par.info();
+		printf("ERROR: fail to write checkpoint to %s. Program abort!\n", cfg.get_ckpt_fname().c_str());
+		exit(EXIT_FAILURE);
+	}
+#if (SGI_PRINT_TIMER==1)
+	fflush(NULL);
+	printf("SGI: wrote checkpoint (%lu bytes) in  %.6f sec\n", h.file_size, MPI_Wtime()-tic);
+#endif
+	return;
+}
+
+/**
+ * All ranks mmap the checkpoint and take grid, alphas and maxpos from it, no hierarchization.
+ * MASTER also writes grid/data/pos files into the output path, so the surrogate can be refined further.
+ * If the checkpoint was built with other sgi_is_logpos/sgi_is_pod settings, alphas are recomputed.
+ */
+void SGI::resume_checkpoint()
 {
+#if (SGI_PRINT_TIMER==1)
+	double tic = MPI_Wtime();
+#endif
 	if (par.is_master()) {
 		fflush(NULL);
 		printf("\n==========================================\n");
-		printf("SGI: Building SGI surrogate from file...\n");
-		// Make a copy of data files
-		string cmd = "cp " + cfg.get_grid_resume_fname() + " " + cfg.get_grid_fname();
-		system(cmd.c_str());	
-		cmd = "cp " + cfg.get_data_resume_fname() + " " + cfg.get_data_fname();
-		system(cmd.c_str());	
-		cmd = "cp " + cfg.get_pos_resume_fname() + " " + cfg.get_pos_fname();
-		system(cmd.c_str());	
+		printf("SGI: Building SGI surrogate from checkpoint...\n");
 	}
-	MPI_Barrier(MPI_COMM_WORLD);
+	std::size_t input_size = cfg.get_input_size();
+	std::size_t output_size = cfg.get_output_size();
+	string ifile = cfg.get_ckpt_resume_fname();
+	int fd = open(ifile.c_str(), O_RDONLY);
+	struct stat st;
+	if ((fd < 0) || (fstat(fd, &st) != 0) || (std::size_t(st.st_size) < sizeof(SGICheckpointHeader))) {
+		par.info();
+		printf("ERROR: fail to open %s for checkpoint read. Program abort!\n", ifile.c_str());
+		exit(EXIT_FAILURE);
+	}
+	void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED) {
+		par.info();
+		printf("ERROR: fail to mmap %s. Program abort!\n", ifile.c_str());
+		exit(EXIT_FAILURE);
+	}
+	const char* base = static_cast<const char*>(addr);
+	const SGICheckpointHeader* h = reinterpret_cast<const SGICheckpointHeader*>(base);
+	if ((strncmp(h->magic, SGI_CKPT_MAGIC, sizeof(h->magic)) != 0) || (h->version != SGI_CKPT_VERSION)
+			|| (h->file_size != uint64_t(st.st_size))) {
+		par.info();
+		printf("ERROR: %s is not a valid SGI checkpoint (version %d). Program abort!\n",
+				ifile.c_str(), SGI_CKPT_VERSION);
+		exit(EXIT_FAILURE);
+	}
+	if ((h->input_size != input_size) || (h->output_size != output_size)) {
+		par.info();
+		printf("ERROR: checkpoint %s does not match input/output size. Program abort!\n", ifile.c_str());
+		exit(EXIT_FAILURE);
+	}
+	// The grid below comes from the checkpoint, so check its basis against sgi_basis here
+	GridType grid_type = (cfg.get_param_string("sgi_basis") == "modbspline") ? GridType::ModBspline : GridType::ModLinear;
+	if (h->grid_type != static_cast<uint64_t>(grid_type)) {
+		par.info();
+		printf("ERROR: checkpoint %s does not match sgi_basis %s. Program abort!\n",
+				ifile.c_str(), cfg.get_param_string("sgi_basis").c_str());
+		exit(EXIT_FAILURE);
+	}
+	std::size_t num_gps = h->num_gps;
+	const double* data = reinterpret_cast<const double*>(base + h->off_data);
+	const double* pos = reinterpret_cast<const double*>(base + h->off_pos);
+
 	// Set: grid, eval, bbox
-	mpiio_read_grid();
-	// Set: alphas
-	compute_hier_alphas();
-	// Read posterior
-	std::size_t num_gps = grid->getSize();
-	unique_ptr<double[]> pos (new double[num_gps]);
-	mpiio_readwrite_pos(true, 0, num_gps-1, pos.get());
+	string sg_str(base + h->off_grid, h->grid_str_size);
+	grid.reset(Grid::unserialize(sg_str).release());
+	bbox.reset(create_boundingbox());
+	grid->setBoundingBox(*bbox);
+	eval.reset(sgpp::op_factory::createOperationEval(*grid).release());
+	seq_maxpos = make_pair(std::size_t(h->seq_maxpos), h->maxpos);
 
-	// Find maxpos, spmd style
-	std::size_t lmin, lmax;
-	mpispmd_get_local_range(0, num_gps-1, lmin, lmax);
-	// Each rank go through local portion to find local maxpos
-	seq_maxpos.first = 0;
-	seq_maxpos.second = 0.0;
-	for (std::size_t i=lmin; i <= lmax; ++i) {
-		if (pos[i] > seq_maxpos.second) {
-			seq_maxpos.first = i;
-			seq_maxpos.second = pos[i];
-		}
+	// MASTER: grid/data/pos files are still needed by refinement
+	if (par.is_master()) {
+		MPI_File_delete(cfg.get_grid_fname().c_str(), MPI_INFO_NULL);
+		MPI_File_delete(cfg.get_data_fname().c_str(), MPI_INFO_NULL);
+		MPI_File_delete(cfg.get_pos_fname().c_str(), MPI_INFO_NULL);
+		mpiio_write_grid();
+		mpiio_readwrite_data(false, 0, num_gps-1, const_cast<double*>(data));
+		mpiio_readwrite_pos(false, 0, num_gps-1, const_cast<double*>(pos));
 	}
-	// Find global maxpos
-	mpispmd_find_global_maxpos();
 
+	// Set: alphas
+	uint64_t flags = (is_logpos ? SGI_CKPT_LOGPOS : 0) | (is_pod ? SGI_CKPT_POD : 0);
+	bool is_alphas_ok = (h->flags == flags);
+	if (is_alphas_ok) {
+		// NOTE: DataVector(double*, size) copies, the mapping itself is never written
+		double* a = reinterpret_cast<double*>(const_cast<char*>(base) + h->off_alphas);
+		alphas.resize(h->num_alphas);
+		for (std::size_t j=0; j < alphas.size(); j++)
+			alphas[j] = DataVector(a + j*num_gps, num_gps);
+		if (is_logpos)
+			alpha_logpos = DataVector(reinterpret_cast<double*>(const_cast<char*>(base) + h->off_logpos), num_gps);
+		if (is_pod) {
+			pod_mean = Eigen::Map<const Eigen::VectorXd>(
+					reinterpret_cast<const double*>(base + h->off_pod_mean), output_size);
+			pod_basis = Eigen::Map<const Eigen::MatrixXd>(
+					reinterpret_cast<const double*>(base + h->off_pod_basis), output_size, h->pod_rank);
+		}
+	}
+	munmap(addr, st.st_size);
+	MPI_Barrier(MPI_COMM_WORLD); // data files must be complete before anyone reads them
+	if (!is_alphas_ok) {
+		if (par.is_master()) {
+			fflush(NULL);
+			printf("SGI: checkpoint built with other sgi_is_logpos/sgi_is_pod settings, recompute alphas.\n");
+		}
+		alphas.resize(output_size);
+		compute_hier_alphas();
+	}
 	if (par.is_master()) {
 		fflush(NULL);
-		printf("SGI: Build SGI surrogate from file successful.\n");
+#if (SGI_PRINT_TIMER==1)
+		printf("SGI: loaded checkpoint in  %.6f sec\n", MPI_Wtime()-tic);
+#endif
+		printf("SGI: Build SGI surrogate from checkpoint successful.\n");
 		printf("==========================================\n\n");
 	}
 	return;
 }
 
+// FNV-1a hash of the serialized grid and the surrogate layout
+uint64_t SGI::get_grid_fingerprint()
+{
+	string str = grid->serialize();
+	str += " " + to_string(alphas.size()) + " " + to_string(is_logpos) + " " + to_string(is_pod);
+	uint64_t h = 14695981039346656037ULL;
+	for (char c: str) {
+		h ^= static_cast<unsigned char>(c);
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+// Continue FNV-1a hash h over the bit patterns of all surpluses (and the POD basis)
+uint64_t SGI::get_alphas_fingerprint(uint64_t h)
+{
+	auto mix = [&h](const double* v, std::size_t n) {
+		const unsigned char* c = reinterpret_cast<const unsigned char*>(v);
+		for (std::size_t b=0; b < n*sizeof(double); b++) {
+			h ^= c[b];
+			h *= 1099511628211ULL;
+		}
+	};
+	for (auto const& alpha: alphas)
+		mix(alpha.getPointer(), alpha.getSize());
+	if (is_logpos) mix(alpha_logpos.getPointer(), alpha_logpos.getSize());
+	if (is_pod) {
+		mix(pod_mean.data(), pod_mean.size());
+		mix(pod_basis.data(), pod_basis.size());
+	}
+	return h;
+}
 
-/*********************************************
- *       		 Private Methods
- *********************************************/
 void SGI::impi_adapt()
 {
 #if (IMPI==1)
@@ -251,6 +1573,11 @@ void SGI::impi_adapt()
 		if (joining_count > 0) {
 			// sync grid offset
 			MPI_Bcast(&impi_gpoffset, 1, MPI_SIZE_T, par.master, newcomm);
+			// sync points already computed by an interrupted job (see prepare_journal), empty if none
+			std::size_t num_gp_done = gp_done.size();
+			MPI_Bcast(&num_gp_done, 1, MPI_SIZE_T, par.master, newcomm);
+			gp_done.resize(num_gp_done);
+			if (num_gp_done > 0) MPI_Bcast(&gp_done[0], num_gp_done, MPI_CHAR, par.master, newcomm);
 			// bcast grid to joining ranks
 			bcast_grid(newcomm);
 
@@ -303,9 +1630,173 @@ vector<double> SGI::get_gp_coord(std::size_t seq)
 	return gp;
 }
 
+DataVector SGI::get_eval_point(vector<double> const& m)
+{
+	DataVector point (m);
+	// ModLinear eval scales point to bounding box itself, B-spline eval does not
+	if (grid->getType() == GridType::ModBspline) {
+		for (size_t i=0; i < point.getSize(); ++i) {
+			DimensionBoundary db = bbox->getBoundary(i);
+			point[i] = (point[i] - db.leftBoundary) / (db.rightBoundary - db.leftBoundary);
+			point[i] = fmin(1.0, fmax(0.0, point[i]));
+		}
+	}
+	return point;
+}
+
+/**
+ * Evaluate columns [col_min, col_min+num_cols) of the reduced (shared/single precision) alphas at m.
+ * Affected basis functions are found once, and all columns are summed in one pass (in double).
+ */
+void SGI::eval_affected(
+		vector<double> const& m,
+		std::size_t col_min,
+		std::size_t num_cols,
+		double* result)
+{
+	std::fill(result, result + num_cols, 0.0);
+	DataVector point (m);
+	for (size_t i=0; i < point.getSize(); ++i) {
+		DimensionBoundary db = bbox->getBoundary(i);
+		point[i] = (point[i] - db.leftBoundary) / (db.rightBoundary - db.leftBoundary);
+	}
+	vector< pair<std::size_t,double> > affected;
+	if (grid->getType() == GridType::ModBspline) {
+		for (size_t i=0; i < point.getSize(); ++i)
+			point[i] = fmin(1.0, fmax(0.0, point[i]));
+		SBsplineModifiedBase basis (dynamic_cast<ModBsplineGrid*>(grid.get())->getDegree());
+		GetAffectedBasisFunctions<SBsplineModifiedBase> ga (grid->getStorage());
+		ga(basis, point, affected);
+	} else {
+		// Same as SGpp ModLinear eval: zero outside of the bounding box
+		for (size_t i=0; i < point.getSize(); ++i)
+			if (point[i] < 0.0 || point[i] > 1.0) return;
+		SLinearModifiedBase basis;
+		GetAffectedBasisFunctions<SLinearModifiedBase> ga (grid->getStorage());
+		ga(basis, point, affected);
+	}
+	if (is_shared && is_sp) {
+		for (auto const& e: affected) {
+			const float* row = shared_alphas_sp + e.first*packed_cols + col_min;
+			for (std::size_t j=0; j < num_cols; j++)
+				result[j] += e.second * static_cast<double>(row[j]);
+		}
+	} else if (is_shared) {
+		for (auto const& e: affected) {
+			const double* row = shared_alphas + e.first*packed_cols + col_min;
+			for (std::size_t j=0; j < num_cols; j++)
+				result[j] += e.second * row[j];
+		}
+	} else if (is_sp) {
+		for (std::size_t j=0; j < num_cols; j++) {
+			const float* a = alphas_sp[col_min+j].getPointer();
+			for (auto const& e: affected)
+				result[j] += e.second * static_cast<double>(a[e.first]);
+		}
+	} else {
+		// Private double precision alphas, the column after the alphas is alpha_logpos
+		for (std::size_t j=0; j < num_cols; j++) {
+			const double* a = (col_min+j < alphas.size()) ?
+					alphas[col_min+j].getPointer() : alpha_logpos.getPointer();
+			for (auto const& e: affected)
+				result[j] += e.second * a[e.first];
+		}
+	}
+	return;
+}
+
+/**
+ * One collective evaluation round over MPI_COMM_WORLD: requests (kind + point) of all ranks
+ * are batched, every rank adds the partial sums of its own subspaces for all requests,
+ * and each rank receives the sums of its own request (all packed_cols columns).
+ * NOTE: all ranks must take part, ranks without request call with DIST_IDLE (serve_distributed).
+ * Returns false if no rank made a request.
+ */
+bool SGI::eval_distributed(
+		vector<double> const& m,
+		int kind,
+		double* result)
+{
+	std::size_t input_size = cfg.get_input_size();
+	// 1. Batch requests of all ranks: {kind, point}
+	vector<double> req (input_size + 1, 0.0);
+	req[0] = kind;
+	std::copy(m.begin(), m.end(), req.begin() + 1);
+	vector<double> reqs (par.size * (input_size + 1));
+	MPI_Allgather(&req[0], input_size + 1, MPI_DOUBLE, &reqs[0], input_size + 1, MPI_DOUBLE, MPI_COMM_WORLD);
+	// 2. Partial sums from own subspaces
+	vector<double> partial (par.size * packed_cols, 0.0);
+	bool is_any = false;
+	for (int r=0; r < par.size; r++) {
+		if (int(reqs[r*(input_size+1)]) == DIST_IDLE) continue;
+		is_any = true;
+		eval_local(&reqs[r*(input_size+1) + 1], &partial[r*packed_cols]);
+	}
+	if (!is_any) return false;
+	// 3. Sum up, rank r gets the r-th block
+	vector<double> sums (packed_cols);
+	MPI_Reduce_scatter_block(&partial[0], &sums[0], packed_cols, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+	if (kind == DIST_RUN) {
+		std::copy(sums.begin(), sums.end(), result);
+	} else if (kind == DIST_LOGPOS) {
+		result[0] = sums[packed_num_alphas];
+	}
+	return true;
+}
+
+/**
+ * Sum over owned subspaces: in each subspace, only the (modified linear) basis function
+ * whose support contains m can be non-zero, its index follows directly from m.
+ */
+void SGI::eval_local(
+		const double* m,
+		double* result)
+{
+	std::size_t input_size = cfg.get_input_size();
+	std::fill(result, result + packed_cols, 0.0);
+	// Same as SGpp ModLinear eval: zero outside of the bounding box
+	vector<double> x (input_size);
+	for (std::size_t d=0; d < input_size; d++) {
+		DimensionBoundary db = bbox->getBoundary(d);
+		x[d] = (m[d] - db.leftBoundary) / (db.rightBoundary - db.leftBoundary);
+		if (x[d] < 0.0 || x[d] > 1.0) return;
+	}
+	SLinearModifiedBase basis;
+	HashGridIndex idx (input_size);
+	std::size_t num_subspaces = dist_levels.size() / input_size;
+	for (std::size_t s=0; s < num_subspaces; s++) {
+		double value = 1.0;
+		for (std::size_t d=0; (d < input_size) && (value != 0.0); d++) {
+			unsigned int l = dist_levels[s*input_size + d];
+			unsigned int i = (x[d] >= 1.0) ? (1u << l) - 1 :
+					2 * static_cast<unsigned int>(x[d] * (1u << (l-1))) + 1;
+			idx.push(d, l, i);
+			value *= basis.eval(l, i, x[d]);
+		}
+		if (value == 0.0) continue;
+		idx.rehash();
+		std::size_t seq = dist_storage->seq(&idx);
+		if (dist_storage->end(seq)) continue;
+		const double* row = &dist_alphas[seq*packed_cols];
+		for (std::size_t j=0; j < packed_cols; j++)
+			result[j] += value * row[j];
+	}
+	return;
+}
+
+Grid* SGI::create_grid()
+{
+	std::size_t input_size = cfg.get_input_size();
+	if (cfg.get_param_string("sgi_basis") == "modbspline") {
+		return Grid::createModBsplineGrid(input_size, cfg.get_param_sizet("sgi_bspline_degree")).release();
+	}
+	return Grid::createModLinearGrid(input_size).release();
+}
+
 double SGI::get_gp_volume(std::size_t seq)
 {
-	return pow(2.0, -grid->getStorage().get(seq)->getLevelSum());
+	// Level sum is unsigned, negate it as double
+	return pow(2.0, -double(grid->getStorage().get(seq)->getLevelSum()));
 }
 
 BoundingBox* SGI::create_boundingbox()
@@ -333,17 +1824,55 @@ void SGI::compute_hier_alphas()
 	// read raw data
 	unique_ptr<double[]> data (new double[output_size * num_gps]);
 	mpiio_readwrite_data(true, 0, num_gps-1, data.get());
-	// re-allocate alphas
-	for (std::size_t j=0; j < output_size; j++)
-		alphas[j].resize(num_gps);
-	// unpack raw data
-	for (std::size_t i=0; i < num_gps; i++)
+	if (is_pod) {
+		// POD: interpolate only the k leading coefficients z = basis^T * (data - mean)
+		compute_pod_basis(data.get(), num_gps);
+		std::size_t k = pod_basis.cols();
+		Eigen::Map<Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor> >
+				snapshots (data.get(), num_gps, output_size);
+		Eigen::MatrixXd coeffs = (snapshots.rowwise() - pod_mean.transpose()) * pod_basis;
+		alphas.resize(k);
+		for (std::size_t j=0; j < k; j++) {
+			alphas[j].resize(num_gps);
+			for (std::size_t i=0; i < num_gps; i++)
+				alphas[j].set(i, coeffs(i,j));
+		}
+	} else {
+		// re-allocate alphas
 		for (std::size_t j=0; j < output_size; j++)
-			alphas[j].set(i, data[i*output_size+j]);
+			alphas[j].resize(num_gps);
+		// unpack raw data
+		for (std::size_t i=0; i < num_gps; i++)
+			for (std::size_t j=0; j < output_size; j++)
+				alphas[j].set(i, data[i*output_size+j]);
+	}
+	// nodal values to be hierarchized
+	vector<DataVector*> nodal;
+	for (std::size_t j=0; j < alphas.size(); j++)
+		nodal.push_back(&alphas[j]);
+	// log-posterior surrogate: reuse posteriors from file
+	if (is_logpos) {
+		unique_ptr<double[]> pos (new double[num_gps]);
+		mpiio_readwrite_pos(true, 0, num_gps-1, pos.get());
+		alpha_logpos.resize(num_gps);
+		for (std::size_t i=0; i < num_gps; i++) {
+			if (pos[i] > 0.0) {
+				alpha_logpos.set(i, log(pos[i]));
+			} else { // posterior underflow, recompute log-posterior from raw data
+				vector<double> d (&data[i*output_size], &data[i*output_size] + output_size);
+				alpha_logpos.set(i, cfg.compute_log_posterior(d));
+			}
+		}
+		nodal.push_back(&alpha_logpos);
+	}
 	// hierarchize alphas
-	auto hier = sgpp::op_factory::createOperationHierarchisation(*grid);
-	for (std::size_t j=0; j<output_size; j++)
-		hier->doHierarchisation(alphas[j]);
+	if (grid->getType() == GridType::ModBspline) {
+		hierarchise_bspline(nodal);
+	} else {
+		auto hier = sgpp::op_factory::createOperationHierarchisation(*grid);
+		for (auto a: nodal)
+			hier->doHierarchisation(*a);
+	}
 #if (SGI_PRINT_TIMER==1)
 	if (par.is_master()) {
 		fflush(NULL);
@@ -353,6 +1882,91 @@ void SGI::compute_hier_alphas()
 	return;
 }
 
+/**
+ * SGpp does not implement hierarchisation for (non-interpolating) B-spline bases.
+ * Solve the interpolation problem A * alpha = f instead, with A_ij = phi_j(x_i).
+ * A is sparse (B-splines have local support), rows are the basis functions affected at x_i.
+ * Only MASTER factorizes A and solves (one factorization for all outputs), then Bcast alphas.
+ */
+void SGI::hierarchise_bspline(vector<DataVector*> const& nodal)
+{
+	std::size_t num_gps = grid->getSize();
+	if (par.is_master()) {
+		std::size_t degree = dynamic_cast<ModBsplineGrid*>(grid.get())->getDegree();
+		SBsplineModifiedBase basis (degree);
+		GetAffectedBasisFunctions<SBsplineModifiedBase> ga (grid->getStorage());
+		vector< pair<std::size_t,double> > affected;
+		vector< Eigen::Triplet<double> > entries;
+		DataVector coord (cfg.get_input_size());
+		// Assemble A row by row
+		for (std::size_t i=0; i < num_gps; i++) {
+			grid->getStorage().get(i)->getCoords(coord); // unit cube coordinates
+			affected.clear();
+			ga(basis, coord, affected);
+			for (auto const& e: affected)
+				entries.push_back(Eigen::Triplet<double>(i, e.first, e.second));
+		}
+		Eigen::SparseMatrix<double> A (num_gps, num_gps);
+		A.setFromTriplets(entries.begin(), entries.end());
+		A.makeCompressed();
+		Eigen::SparseLU< Eigen::SparseMatrix<double> > solver;
+		solver.compute(A);
+		if (solver.info() != Eigen::Success) {
+			par.info();
+			printf("ERROR: SGI B-spline interpolation matrix factorization failed. Program abort!\n");
+			exit(EXIT_FAILURE);
+		}
+		// Solve for each nodal vector
+		for (auto a: nodal) {
+			Eigen::Map<Eigen::VectorXd> f (a->getPointer(), num_gps);
+			Eigen::VectorXd x = solver.solve(f);
+			f = x;
+		}
+	}
+	for (auto a: nodal)
+		MPI_Bcast(a->getPointer(), num_gps, MPI_DOUBLE, par.master, MPI_COMM_WORLD);
+	return;
+}
+
+/**
+ * POD (aka PCA) of the output snapshots at all grid points:
+ *   C = (Y - mean)^T (Y - mean), Y is num_gps-by-output_size
+ * The k leading eigenvectors of C (capturing sgi_pod_energy of the total variance) form the basis.
+ * Only MASTER computes, then Bcast, so that all ranks use an identical basis.
+ */
+void SGI::compute_pod_basis(
+		const double* data,
+		std::size_t num_gps)
+{
+	std::size_t output_size = cfg.get_output_size();
+	int k = 0;
+	pod_mean.resize(output_size);
+	if (par.is_master()) {
+		Eigen::Map<const Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor> >
+				snapshots (data, num_gps, output_size);
+		pod_mean = snapshots.colwise().mean().transpose();
+		Eigen::MatrixXd centered = snapshots.rowwise() - pod_mean.transpose();
+		Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> es (centered.transpose() * centered);
+		// Eigenvalues are sorted increasingly, find k leading ones that capture enough energy
+		Eigen::VectorXd ev = es.eigenvalues().reverse().cwiseMax(0.0);
+		double energy = cfg.get_param_double("sgi_pod_energy");
+		double total = ev.sum();
+		double captured = 0.0;
+		do {
+			captured += ev(k++);
+		} while ((k < int(output_size)) && (captured < energy * total));
+		pod_basis = es.eigenvectors().rightCols(k).rowwise().reverse();
+		fflush(NULL);
+		printf("SGI: POD basis %d of %lu outputs, captured energy %.8f\n",
+				k, output_size, (total > 0.0) ? captured/total : 1.0);
+	}
+	MPI_Bcast(&k, 1, MPI_INT, par.master, MPI_COMM_WORLD);
+	pod_basis.resize(output_size, k); // no-op on MASTER
+	MPI_Bcast(pod_mean.data(), output_size, MPI_DOUBLE, par.master, MPI_COMM_WORLD);
+	MPI_Bcast(pod_basis.data(), output_size*k, MPI_DOUBLE, par.master, MPI_COMM_WORLD);
+	return;
+}
+
 void SGI::compute_grid_points(
 		std::size_t gp_offset,
 		bool is_masterworker)
@@ -362,8 +1976,9 @@ void SGI::compute_grid_points(
 #endif
 	// NOTE: "Master-minion" scheme can run under MPI & iMPI
 	// 		 "Naive" (aka SIMD) scheme can run under only MPI
+	is_phase_stop = false;
 	if (is_masterworker) {
-		// Master-worker style
+		// Master-worker style (pipelined check is done by MASTER after seeding the workers)
 		if (par.is_master()) {
 			mpimw_master_compute(gp_offset);
 		} else {
@@ -372,14 +1987,22 @@ void SGI::compute_grid_points(
 		// Bcast maxpos
 		mpimw_master_bcast_maxpos(); // Includes MPI_Bcast
 	} else {
-		// MPI native style (default)
+		// MPI native style (default), never pipelined
 		std::size_t num_gps = grid->getSize();
 		std::size_t mymin, mymax;
 		mpispmd_get_local_range(gp_offset, num_gps-1, mymin, mymax);
-		compute_gp_range(mymin, mymax);
+		// In jobsize chunks, so the journal keeps finished chunks of an interrupted phase
+		std::size_t jobsize = std::max(std::size_t(1), cfg.get_param_sizet("sgi_masterworker_jobsize"));
+		for (std::size_t seq=mymin; seq <= mymax; seq += jobsize)
+			compute_gp_range(seq, std::min(seq + jobsize - 1, mymax));
 		// Find global maxpos
 		mpispmd_find_global_maxpos(); // Includes MPI_Allreduce and MPI_Bcast
 	}
+	if (phase_check) {
+		int is_stop = is_phase_stop ? 1 : 0;
+		MPI_Bcast(&is_stop, 1, MPI_INT, par.master, MPI_COMM_WORLD);
+		is_phase_stop = (is_stop == 1);
+	}
 	//MPI_Barrier(MPI_COMM_WORLD); // no need for barrier due to MPI_Bcast
 
 #if (SGI_PRINT_TIMER==1)
@@ -409,11 +2032,25 @@ void SGI::compute_gp_range(
 	vector<double> dvec;
 	double* d = nullptr;
 	double* p = nullptr;
+	// Points computed by an interrupted job are read from file instead
+	bool is_partial = !gp_done.empty() &&
+			std::any_of(gp_done.begin()+seq_min, gp_done.begin()+seq_max+1, [](char c){return c != 0;});
+	if (is_partial) {
+		mpiio_readwrite_data(true, seq_min, seq_max, data.get());
+		mpiio_readwrite_pos(true, seq_min, seq_max, pos.get());
+	}
 
 	for (std::size_t i=seq_min; i <= seq_max; ++i) {
 		// Set output pointer
 		d = &data[0] + (i-seq_min) * output_size;
 		p = &pos[0] + (i-seq_min);
+		if (is_partial && gp_done[i]) {
+			if (*p > seq_maxpos.second) {
+				seq_maxpos.first = i;
+				seq_maxpos.second = *p;
+			}
+			continue;
+		}
 		// compute with full model
 		dvec = fullmodel.run( get_gp_coord(i) );
 		std::copy(dvec.begin(), dvec.end(), d);
@@ -430,9 +2067,10 @@ void SGI::compute_gp_range(
 				i, tools::sample_to_string(get_gp_coord(i)), *p);
 #endif
 	}
-	// Write results to file
+	// Write results to file, then mark them finished in the journal
 	mpiio_readwrite_data(false, seq_min, seq_max, data.get());
 	mpiio_readwrite_pos(false, seq_min, seq_max, pos.get());
+	mpiio_mark_journal(seq_min, seq_max);
 	return;
 }
 
@@ -515,10 +2153,9 @@ void SGI::refine_grid_mpiio(double portion_to_refine)
 		// For each gp, compute the refinement index
 		double data_norm;
 		DataVector refine_idx (num_gps);
-		std::size_t output_size = cfg.get_output_size();
 		for (std::size_t i=0; i<num_gps; i++) {
 			data_norm = 0;
-			for (std::size_t j=0; j < output_size; j++) {
+			for (std::size_t j=0; j < alphas.size(); j++) { // with POD: |z| ~= |data| (orthonormal basis)
 				data_norm += (alphas[j][i] * alphas[j][i]);
 			}
 			data_norm = sqrt(data_norm);
@@ -570,23 +2207,9 @@ void SGI::refine_grid_bcast(double portion_to_refine)
 			printf("SGI: refine grid failed due to no points to refine. Program abort!\n");
 			exit(EXIT_FAILURE);	
 		};
-		// Read posterior from file
-		unique_ptr<double[]> pos (new double[num_gps]);
-		mpiio_readwrite_pos(true, 0, num_gps-1, &pos[0]);
 		// For each gp, compute the refinement index
-		double data_norm;
 		DataVector refine_idx (num_gps);
-		std::size_t output_size = cfg.get_output_size();
-		for (std::size_t i=0; i<num_gps; i++) {
-			data_norm = 0;
-			for (std::size_t j=0; j < output_size; j++) {
-				data_norm += (alphas[j][i] * alphas[j][i]); //TODO: high-dim not to use l2-norm
-			}
-			data_norm = sqrt(data_norm);
-			// refinement_index = |alpha| * V * posterior, where
-			// Point volume V := 2^{-(l1+l2+...+ld)}
-			refine_idx[i] = data_norm * get_gp_volume(i) * pos[i];
-		}
+		compute_refine_index(refine_idx);
 		// refine grid
 		grid->refine(refine_idx, refine_gps);
 		std::size_t new_num_gps = grid->getSize();
@@ -603,6 +2226,133 @@ void SGI::refine_grid_bcast(double portion_to_refine)
 	return;
 }
 
+/**
+ * Dimension-adaptive (anisotropic) refine scheme: only MASTER refines grid, then bcast it
+ *
+ * Per-dimension importance: each point's refinement index is split among the dimensions
+ * in which the point lies above level 1, weighted by (l_d - 1). Importance is normalized to max 1.
+ * The top refine_gps points (same count as spatial refinement) get children only in the
+ * dimensions with importance >= sgi_refine_dim_threshold, instead of in all 2*d directions.
+ */
+void SGI::refine_grid_bcast_aniso(double portion_to_refine)
+{
+	// Master refine grid
+	if (par.is_master()) {
+#if (SGI_PRINT_TIMER==1)
+		double tic = MPI_Wtime();
+#endif
+		std::size_t input_size = cfg.get_input_size();
+		// Compute threshold number of grid points to be added
+		// NOTE: to refine X points, maximum (2*dim*X) points can be added to grid
+		int maxi = 10000;
+		int thres = int(ceil(maxi / 2 / input_size));
+		// Number of points to refine
+		std::size_t num_gps = this->grid->getSize();
+		int refine_gps = int(ceil(num_gps * portion_to_refine));
+		refine_gps = (refine_gps > thres) ? thres : refine_gps;
+		// If no points to refine abort
+		if (refine_gps < 1) {
+			par.info();
+			printf("SGI: refine grid failed due to no points to refine. Program abort!\n");
+			exit(EXIT_FAILURE);
+		};
+		// For each gp, compute the refinement index
+		DataVector refine_idx (num_gps);
+		compute_refine_index(refine_idx);
+
+		// Estimate per-dimension importance
+		GridStorage& storage = grid->getStorage();
+		vector<double> importance (input_size, 0.0);
+		GridStorage::index_type::level_type l;
+		GridStorage::index_type::index_type idx;
+		for (std::size_t i=0; i < num_gps; i++) {
+			double lsum = double(storage.get(i)->getLevelSum()) - double(input_size);
+			if (lsum <= 0.0) continue; // root point is not refined in any dimension
+			for (std::size_t d=0; d < input_size; d++) {
+				storage.get(i)->get(d, l, idx);
+				importance[d] += refine_idx[i] * double(l - 1) / lsum;
+			}
+		}
+		double imax = *std::max_element(importance.begin(), importance.end());
+		vector<bool> is_dim_refined (input_size, true);
+		if (imax > 0.0) {
+			for (std::size_t d=0; d < input_size; d++) {
+				importance[d] /= imax;
+				is_dim_refined[d] = (importance[d] >= cfg.get_param_double("sgi_refine_dim_threshold"));
+			}
+		}
+		fflush(NULL);
+		printf("SGI: dimension importance %s\n", tools::sample_to_string(importance).c_str());
+
+		// Find refinable points (missing a child in any refined dimension), sorted by refinement index
+		vector<std::size_t> candidates;
+		for (std::size_t i=0; i < num_gps; i++) {
+			GridStorage::index_type child (*storage.get(i));
+			for (std::size_t d=0; d < input_size; d++) {
+				if (!is_dim_refined[d]) continue;
+				child.get(d, l, idx);
+				child.set(d, l+1, 2*idx-1);
+				bool has_left = storage.has_key(&child);
+				child.set(d, l+1, 2*idx+1);
+				bool has_right = storage.has_key(&child);
+				child.set(d, l, idx);
+				if (!has_left || !has_right) {
+					candidates.push_back(i);
+					break;
+				}
+			}
+		}
+		std::size_t n = std::min(candidates.size(), std::size_t(refine_gps));
+		std::partial_sort(candidates.begin(), candidates.begin()+n, candidates.end(),
+				[&refine_idx](std::size_t a, std::size_t b) {return refine_idx[a] > refine_idx[b];});
+		// Refine selected points in refined dimensions only (new points are appended to storage)
+		HashRefinement refinement;
+		for (std::size_t k=0; k < n; k++) {
+			// Refine a copy of the key (as HashRefinement::refineGridpoint): refineGridpoint1D modifies
+			// the index it is given and inserting children may rehash the storage
+			GridStorage::index_type idx (*storage.get(candidates[k]));
+			storage.get(candidates[k])->setLeaf(false);
+			for (std::size_t d=0; d < input_size; d++) {
+				if (is_dim_refined[d])
+					refinement.refineGridpoint1D(storage, idx, d);
+			}
+		}
+		std::size_t new_num_gps = grid->getSize();
+		// print grid info
+		fflush(NULL);
+		printf("SGI: total %zu gps, %zu added, range [%zu, %zu]\n",
+				new_num_gps, new_num_gps-num_gps, num_gps, new_num_gps-1);
+#if (SGI_PRINT_TIMER==1)
+		printf("SGI: refined grid in %.6f seconds.\n", MPI_Wtime()-tic);
+#endif
+	}
+	// Bcast the grid
+	bcast_grid(MPI_COMM_WORLD);
+	return;
+}
+
+/**
+ * For each gp, compute the refinement index (MASTER only, reads posterior file)
+ * refinement_index = |alpha| * V * posterior, where point volume V := 2^{-(l1+l2+...+ld)}
+ */
+void SGI::compute_refine_index(DataVector& refine_idx)
+{
+	std::size_t num_gps = grid->getSize();
+	// Read posterior from file
+	unique_ptr<double[]> pos (new double[num_gps]);
+	mpiio_readwrite_pos(true, 0, num_gps-1, &pos[0]);
+	double data_norm;
+	for (std::size_t i=0; i<num_gps; i++) {
+		data_norm = 0;
+		for (std::size_t j=0; j < alphas.size(); j++) { // with POD: |z| ~= |data| (orthonormal basis)
+			data_norm += (alphas[j][i] * alphas[j][i]); //TODO: high-dim not to use l2-norm
+		}
+		data_norm = sqrt(data_norm);
+		refine_idx[i] = data_norm * get_gp_volume(i) * pos[i];
+	}
+	return;
+}
+
 void SGI::mpiio_write_grid()
 {
 	// Pack grid into Char array
@@ -751,6 +2501,33 @@ void SGI::mpiio_readwrite_pos(
 	return;
 }
 
+void SGI::mpiio_mark_journal(
+		std::size_t seq_min,
+		std::size_t seq_max)
+{
+	// Do something only when seq_min <= seq_max
+	if (seq_min > seq_max) return;
+
+	string ofile = cfg.get_journal_fname();
+	vector<char> done (seq_max-seq_min+1, 1);
+	MPI_File fh;
+	if (MPI_File_open(MPI_COMM_SELF, ofile.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh)
+			!= MPI_SUCCESS) {
+		par.info();
+		printf("ERROR: fail to open %s for journal write. Program abort!\n", ofile.c_str());
+		exit(EXIT_FAILURE);
+	}
+	// offset is in # of bytes, and is ALWAYS calculated from beginning of file.
+	if (MPI_File_write_at(fh, SGI_JOURNAL_OFFSET + seq_min, &done[0],
+			done.size(), MPI_CHAR, MPI_STATUS_IGNORE) != MPI_SUCCESS) {
+		par.info();
+		printf("ERROR: fail to write journal to %s. Program abort!\n", ofile.c_str());
+		exit(EXIT_FAILURE);
+	}
+	MPI_File_close(&fh);
+	return;
+}
+
 void SGI::mpispmd_get_local_range(
 		const std::size_t& gmin,
 		const std::size_t& gmax,
@@ -827,6 +2604,13 @@ void SGI::mpimw_master_compute(std::size_t gp_offset)
 	print_workers(workers);
 #endif
 
+	// Pipelined: check the previous phase while workers compute, skip remaining jobs if converged
+	if (phase_check) {
+		is_phase_stop = phase_check();
+		if (is_phase_stop)
+			std::replace(jobs.begin(), jobs.end(), char(JOBTODO), char(JOBDONE));
+	}
+
 	// As long as not all jobs are done, keep working...
 	while (!std::all_of(jobs.begin(), jobs.end(), [](char i){return i==JOBDONE;})) {
 
@@ -22,11 +22,22 @@
 #include <model/ForwardModel.hpp>
 #include <tools/Parallel.hpp>
 #include <tools/Config.hpp>
+#include <tools/RandomStream.hpp>
 #include <model/NS.hpp>
 #include <sgpp_base.hpp>
+#include <sgpp/base/datatypes/DataVectorSP.hpp>
+#include <Eigen/Eigen>
 
 #include <mpi.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <cstdint>
+#include <cstring>
 #include <memory>
+#include <functional>
 #include <string>
 #include <vector>
 #include <map>
@@ -45,6 +56,50 @@
 #define RANKACTIVE	'a'
 #define RANKIDLE	'i'
 
+#define DIST_IDLE	0
+#define DIST_RUN	1
+#define DIST_LOGPOS	2
+
+#define SGI_CKPT_MAGIC		"EBSGICK"
+#define SGI_CKPT_VERSION	1
+#define SGI_CKPT_LOGPOS		0x1
+#define SGI_CKPT_POD		0x2
+
+// Completion journal (done.mpibin): magic | grid fingerprint | num_gps | one byte per grid point
+#define SGI_JOURNAL_MAGIC	"EBSGIJN"
+#define SGI_JOURNAL_OFFSET	24
+
+/**
+ * Header of the SGI checkpoint file (one file = one complete surrogate).
+ * All sections start at 8-byte aligned offsets, so the file can be mmap-ed and read in place:
+ *   grid string | alphas (num_alphas x num_gps) | alpha_logpos (num_gps) |
+ *   pod_mean (output_size) | pod_basis (output_size x pod_rank, col-major) |
+ *   data (num_gps x output_size) | pos (num_gps)
+ */
+struct SGICheckpointHeader
+{
+	char 		magic[8];
+	uint64_t 	version;
+	uint64_t 	input_size;
+	uint64_t 	output_size;
+	uint64_t 	num_gps;
+	uint64_t 	num_alphas;
+	uint64_t 	pod_rank;
+	uint64_t 	grid_type;
+	uint64_t 	flags;
+	uint64_t 	seq_maxpos;
+	double 		maxpos;
+	uint64_t 	grid_str_size;
+	uint64_t 	off_grid;
+	uint64_t 	off_alphas;
+	uint64_t 	off_logpos;
+	uint64_t 	off_pod_mean;
+	uint64_t 	off_pod_basis;
+	uint64_t 	off_data;
+	uint64_t 	off_pos;
+	uint64_t 	file_size;
+};
+
 class SGI : public ForwardModel
 {
 public:
@@ -57,9 +112,66 @@ public:
 
 	std::vector<double> run(
 			std::vector<double> const& m);
+
+	// With sgi_is_logpos, evaluates the scalar log-posterior surrogate only
+	double compute_posterior(std::vector<double> const& m);
+
+	// Batched posteriors (see ForwardModel), basis functions affecting a point are found once for all outputs
+	void compute_posterior_batch(
+			std::vector<double> const& ms,
+			std::size_t n,
+			double* pos);
+
+	// DEBUG ONLY: abort if batched and point-wise posteriors disagree at num_points random points
+	// (e.g. after the alphas were shared or reduced to single precision)
+	void check_posterior_batch(std::size_t num_points);
 	
 	void build();
 
+	// Refinement phase that overlaps with MASTER running is_converged() on the current surrogate,
+	// the new phase is discarded if it returns true (return value)
+	bool build_pipelined(std::function<bool()> const& is_converged);
+
+	// A-posteriori error estimate from the surpluses of the points added by the last build phase
+	// (optionally posterior-weighted), collective, needs no model runs
+	double estimate_error(bool is_weighted);
+
+	// Remove grid points with negligible surpluses (across all outputs)
+	std::size_t coarsen(double threshold);
+
+	// Accept: write coarsened grid/data/pos to files; Reject: restore grid from files
+	void coarsen_finalize(bool is_accept);
+
+	// Move alphas into a node-shared window (one copy per node), private copies are freed
+	void share_alphas();
+
+	// Restore private alphas from the node-shared window and free the window
+	void unshare_alphas();
+
+	// Free the node-shared window without restoring private alphas (surrogate is unusable after)
+	void free_shared();
+
+	// Partition grid points and alphas by subspace over all ranks (evaluation becomes collective)
+	void distribute_alphas();
+
+	// Gather all grid points and alphas back to every rank
+	void undistribute_alphas();
+
+	// Answer distributed evaluations of other ranks, until no rank requests any more
+	void serve_distributed();
+
+	// Write C++ source of a specialized evaluator for the current grid and alphas (modlinear only)
+	void write_evaluator(std::string const& fname);
+
+	// Load a compiled evaluator (from write_evaluator), run() and compute_posterior() then call it
+	void load_evaluator(std::string const& libname);
+
+	// Store alphas in single precision for evaluation (accumulation stays in double)
+	void reduce_precision();
+
+	// Restore double precision alphas (values keep the single precision rounding)
+	void restore_precision();
+
 //	void duplicate(
 //			const std::string& gridfile,
 //			const std::string& datafile,
@@ -78,6 +190,13 @@ private:
 	// Internal sparse grid objects
 	// f(x) ~= sum_i ( alpha_i * phi_i (x) )
 	std::vector<sgpp::base::DataVector> 		alphas; // list of alphas. vector.size() = output_size, each alpha.size() = num_grid_points)
+	// log(posterior) ~= sum_i ( alpha_logpos_i * phi_i (x) ), only with sgi_is_logpos
+	sgpp::base::DataVector						alpha_logpos;
+	bool is_logpos;
+	// POD of outputs: f(x) ~= pod_mean + pod_basis * z(x), with alphas interpolating z (only with sgi_is_pod)
+	Eigen::VectorXd pod_mean;	// output_size
+	Eigen::MatrixXd pod_basis;	// output_size-by-k
+	bool is_pod;
 	// Abstract type cannot be instanciated, must use pointers
 	std::unique_ptr<sgpp::base::Grid> 			grid; // Sparse grid, containing grid points (input parameters)
 	std::unique_ptr<sgpp::base::OperationEval> 	eval;
@@ -86,20 +205,101 @@ private:
 	// maxpos grid point (gp_seq + maspos)
 	std::pair<std::size_t, double> seq_maxpos;
 	std::size_t impi_gpoffset = 0; //MPI_SIZE_T
+	// Pipelined build: check of the previous phase (MASTER only), and its result
+	std::function<bool()> phase_check;
+	bool is_phase_stop = false;
+	std::size_t est_offset = 0; // first grid point added by the last refinement (0: initial/resumed grid)
+
+	// After coarsening: the (pre-coarsening) seq of each remaining grid point
+	std::vector<std::size_t> coarsen_remaining;
+
+	// Reduced storage used for evaluation only (see reduce_precision, share_alphas),
+	// columns are alphas followed by alpha_logpos (if sgi_is_logpos)
+	std::size_t packed_num_alphas = 0;
+	std::size_t packed_cols = 0;
+	// Single precision alphas, one DataVectorSP per column
+	bool is_sp = false;
+	std::vector<sgpp::base::DataVectorSP> alphas_sp;
+	// Node-shared alphas: num_gps-by-packed_cols, row-major, in double or single (is_sp) precision
+	bool is_shared = false;
+	MPI_Comm node_comm;
+	MPI_Win shared_win;
+	const double* shared_alphas = nullptr;
+	const float* shared_alphas_sp = nullptr;
+	// Compiled evaluator (see load_evaluator)
+	void* aot_handle = nullptr;
+	void (*aot_eval)(const double*, double*) = nullptr;
+	double (*aot_logpos)(const double*) = nullptr;
+	// Distributed alphas: each rank owns whole subspaces, i.e. their grid points (dist_storage),
+	// alphas (num_local_gps-by-packed_cols, row-major) and global seqs
+	bool is_distributed = false;
+	std::unique_ptr<sgpp::base::GridStorage>	dist_storage;
+	std::vector<unsigned int>	dist_levels; // level vectors of owned subspaces, input_size each
+	std::vector<double>			dist_alphas;
+	std::vector<std::size_t>	dist_seqs;
+
+	// Points of the current phase already computed by an interrupted job (read, not recomputed)
+	std::vector<char>			gp_done;
+	// Journal of an interrupted job in the resume path (MASTER only, until it is used)
+	uint64_t					journal_fingerprint = 0;
+	std::vector<char>			journal_done;
+	std::vector<double>			journal_data;
+	std::vector<double>			journal_pos;
 
 private:
-	void resume();
+	bool resume();
+
+	void load_journal();
+
+	void prepare_journal(std::size_t gp_offset);
+
+	void resume_checkpoint();
+
+	void backup_files();
+
+	void write_checkpoint();
 
 	void impi_adapt();
 
+	uint64_t get_grid_fingerprint();
+
+	uint64_t get_alphas_fingerprint(uint64_t h);
+
+	void discard_refinement(std::size_t gp_offset);
+
 	std::vector<double> get_gp_coord(std::size_t seq);
 
+	sgpp::base::DataVector get_eval_point(std::vector<double> const& m);
+
+	void eval_affected(
+			std::vector<double> const& m,
+			std::size_t col_min,
+			std::size_t num_cols,
+			double* result);
+
+	bool eval_distributed(
+			std::vector<double> const& m,
+			int kind,
+			double* result);
+
+	void eval_local(
+			const double* m,
+			double* result);
+
+	sgpp::base::Grid* create_grid();
+
 	double get_gp_volume(std::size_t seq);
 
 	sgpp::base::BoundingBox* create_boundingbox();
 
 	void compute_hier_alphas();
 
+	void hierarchise_bspline(std::vector<sgpp::base::DataVector*> const& nodal);
+
+	void compute_pod_basis(
+			const double* data,
+			std::size_t num_gps);
+
 	void compute_grid_points(
 			std::size_t gp_offset,
 			bool is_masterworker);
@@ -118,6 +318,11 @@ private:
 	// Single refine strategy: MASTER refine then bcast
 	void refine_grid_bcast(double portion_to_refine);
 
+	// Dimension-adaptive refine strategy: MASTER refine (only important dimensions) then bcast
+	void refine_grid_bcast_aniso(double portion_to_refine);
+
+	void compute_refine_index(sgpp::base::DataVector& refine_idx);
+
 	void mpiio_read_grid();
 
 	void mpiio_write_grid();
@@ -134,6 +339,10 @@ private:
 			std::size_t seq_max,
 			double* buff);
 
+	void mpiio_mark_journal(
+			std::size_t seq_min,
+			std::size_t seq_max);
+
 	void mpispmd_get_local_range(
 			const std::size_t& gmin,
 			const std::size_t& gmax,
@@ -56,7 +56,7 @@ Config::Config(int argc, char** argv)
 	}
 	f = get_param_string("sgi_resume_path");
 	if (f != "") {
-		cmd = "if [ -f " + get_grid_resume_fname() + " ]; then echo yes; else echo no; fi";
+		cmd = "if [ -f " + get_ckpt_resume_fname() + " ] || [ -f " + get_grid_resume_fname() + " ] || [ -f " + get_journal_resume_fname() + " ]; then echo yes; else echo no; fi";
 		if (!tools::exec(cmd.c_str()).compare("yes")) {
 			cout << "WARNING: grid file cannot be found in resume path! SGI surrogate will be built from scratch instead." << endl;
 			params.at("sgi_resume_path").val = "";
@@ -90,6 +90,19 @@ double Config::compute_posterior(std::vector<double> const& data) const
 	return exp(-0.5 * sum / (observation_sigma*observation_sigma));
 }
 
+double Config::compute_log_posterior(std::vector<double> const& data) const
+{
+	if (observation.size() != data.size()) {
+		fflush(NULL);
+		printf("ERROR: vectors size mismatch. Program abort!\n");
+		exit(EXIT_FAILURE);
+	}
+	double sum = 0.0;
+	for (int i=0; i < data.size(); ++i)
+		sum += (data[i] - observation[i])*(data[i] - observation[i]);
+	return -0.5 * sum / (observation_sigma*observation_sigma);
+}
+
 void Config::add_params()
 {
 	string var;
@@ -106,6 +119,16 @@ void Config::add_params()
 	p.val = "8";
 	params[var] = p;
 
+	var = "global_surrogate";
+	p.des = "Surrogate model used for MCMC: SGI (adaptive sparse grid interpolation) or SGCT (sparse grid combination technique). (Default: sgi) (Type: string. Options: sgi|sgct)";
+	p.val = "sgi";
+	params[var] = p;
+
+	var = "global_seed";
+	p.des = "Seed of all random streams (MCMC chains, exchange schedule, test points), a run is reproducible for a given seed. 0 = random seed, printed at start. (Default: 0) (Type: size_t)";
+	p.val = "0";
+	params[var] = p;
+
 	var = "global_observation";
 	p.des = "Observed data. (Default: <obs4_data_set>) (Note: provide vector in one line separated by space)";
 	p.val = "1.434041 1.375464 1.402000 0.234050 1.387931 1.006520 1.850871 1.545131 1.563303 0.973778 1.512808 1.387468 1.608557 0.141381 1.313631 0.990608 1.741001 1.551365 1.789867 1.170761  1.597586 1.509048 1.549320 0.135403 1.191323 1.015913 1.682937 1.592488 1.743632 1.296677 1.535493 1.341702 1.541945 0.137985 1.272473 1.041918 1.824279 1.690430 1.810520 1.358992";
@@ -150,7 +173,7 @@ void Config::add_params()
 	params[var] = p;
 	
 	var = "sgi_resume_path";
-	p.des = "If resume path is provided and exist, SGI model will be built from the grid/data files in the path. Otherwise, SGI is built from scratch. (Default: "") (Type: string)";
+	p.des = "If resume path is provided and exist, SGI model will be built from the checkpoint sgi.ckpt (or the grid/data files) in the path, and grid points already computed by an interrupted phase (journal done.mpibin) are not recomputed. Otherwise, SGI is built from scratch. (Default: "") (Type: string)";
 	p.val = "";
 	params[var] = p;
 
@@ -164,17 +187,108 @@ void Config::add_params()
 	p.val = "0.1";
 	params[var] = p;
 
+	var = "sgi_refine_strategy";
+	p.des = "Grid refinement strategy: spatial refines selected points in all dimensions, dimension refines them only in dimensions with estimated importance >= sgi_refine_dim_threshold. (Default: spatial) (Type: string. Options: spatial|dimension)";
+	p.val = "spatial";
+	params[var] = p;
+
+	var = "sgi_refine_dim_threshold";
+	p.des = "For dimension refinement strategy only: dimensions with normalized importance below this are not refined. (Default: 0.1) (Type: double in [0.0, 1.0])";
+	p.val = "0.1";
+	params[var] = p;
+
 	var = "sgi_is_masterworker";
 	p.des = "SGI construction style, enable to use Master-Worker (iMPI or MPI), disable to use SIMD (MPI only). (Default: yes) (Options: yes|no)";
 	p.val = "yes";
 	params[var] = p;
 
+	var = "sgi_is_pipelined";
+	p.des = "Enable to overlap SGI build phases: the next refinement is computed while MASTER checks the error of the current phase, and it is discarded if that phase already converged (needs sgi_error_estimator test and sgi_is_masterworker yes). (Default: no) (Options: yes|no)";
+	p.val = "no";
+	params[var] = p;
+
 	var = "sgi_masterworker_jobsize";
-	p.des = "For SGI construction Master-Worker style: # of grid points to compute in a job. (Default: 10) (Type: size_t)";
+	p.des = "For SGI construction Master-Worker style: # of grid points to compute in a job (SPMD style: # of grid points per journal update). (Default: 10) (Type: size_t)";
 	p.val = "10";
 	params[var] = p;
 
+	var = "sgi_basis";
+	p.des = "SGI sparse grid basis type. Higher order B-splines need fewer grid points for smooth outputs. (Default: modlinear) (Type: string. Options: modlinear|modbspline)";
+	p.val = "modlinear";
+	params[var] = p;
+
+	var = "sgi_bspline_degree";
+	p.des = "For modbspline basis only: B-spline degree (odd). (Default: 3) (Type: size_t)";
+	p.val = "3";
+	params[var] = p;
+
+	var = "sgi_is_logpos";
+	p.des = "Enable to also build a scalar log-posterior surrogate, which MCMC then evaluates instead of all outputs (full-output surrogate is still used for ErrorAnalysis). (Default: no) (Options: yes|no)";
+	p.val = "no";
+	params[var] = p;
+
+	var = "sgi_is_pod";
+	p.des = "Enable to interpolate only the leading POD (PCA) coefficients of the outputs instead of all outputs. (Default: no) (Options: yes|no)";
+	p.val = "no";
+	params[var] = p;
+
+	var = "sgi_pod_energy";
+	p.des = "For POD only: number of POD modes is chosen to capture this portion of the total output variance. (Default: 0.9999) (Type: double in [0.0, 1.0])";
+	p.val = "0.9999";
+	params[var] = p;
+
+	var = "sgi_error_estimator";
+	p.des = "Stopping criterion of the SGI build phases: ErrorAnalysis error at the full-model test points (test), or error estimated from the surpluses of the points added by the last phase (surplus), optionally posterior-weighted (surplus_pos), which needs no extra model runs (modlinear basis only). SGCT always uses test. (Default: test) (Type: string. Options: test|surplus|surplus_pos)";
+	p.val = "test";
+	params[var] = p;
+
+	var = "sgi_is_coarsen";
+	p.des = "Enable to coarsen the SGI surrogate after build (remove grid points with negligible surpluses), coarsened grid is kept only if ErrorAnalysis error stays within max(sgi_tol, error before coarsening). (Default: no) (Options: yes|no)";
+	p.val = "no";
+	params[var] = p;
+
+	var = "sgi_coarsen_threshold";
+	p.des = "Grid points with max_j(|alpha_j| / max|alpha_j|) below this threshold (for all outputs j) are removed by coarsening. (Default: 0.001) (Type: double in [0.0, 1.0])";
+	p.val = "0.001";
+	params[var] = p;
+
+	var = "sgi_alpha_precision";
+	p.des = "Storage precision of the SGI surpluses used by MCMC, single halves memory traffic of surrogate evaluation (sums are still in double), ErrorAnalysis reports the error of both. (Default: double) (Type: string. Options: double|single)";
+	p.val = "double";
+	params[var] = p;
+
+	var = "sgi_is_shared";
+	p.des = "Enable to keep one copy of the SGI surpluses per node (MPI-3 shared memory window) during MCMC, instead of one copy per rank. (Default: no) (Options: yes|no)";
+	p.val = "no";
+	params[var] = p;
+
+	var = "sgi_is_distributed";
+	p.des = "Enable to partition SGI grid points and surpluses by subspace over all ranks during MCMC, evaluations are batched and answered collectively (modlinear basis, double precision alphas and no sgi_is_shared only). (Default: no) (Options: yes|no)";
+	p.val = "no";
+	params[var] = p;
+
+	var = "sgi_is_export_eval";
+	p.des = "Enable to write C++ source of an evaluator specialized to the final SGI grid (sgi_eval.cpp in output path), to be compiled into a shared library for sgi_eval_lib or external tools (modlinear basis only). (Default: no) (Options: yes|no)";
+	p.val = "no";
+	params[var] = p;
+
+	var = "sgi_eval_lib";
+	p.des = "If provided, the compiled evaluator library (built from sgi_eval.cpp of the same surrogate) is loaded and used for surrogate evaluations (sgi_alpha_precision double only). (Default: "") (Type: string)";
+	p.val = "";
+	params[var] = p;
+
+	// SGCT setting
+	var = "sgct_init_level";
+	p.des = "SGCT combination technique level of the first build, each further build phase adds one level. (Default: 4) (Type: size_t)";
+	p.val = "4";
+	params[var] = p;
+
 	// MCMC setting
+	var = "mcmc_method";
+	p.des = "MCMC sampler: pt (Parallel Tempering), mh (Metropolis-Hastings) or mtm (multiple-try Metropolis, see mcmc_mtm_tries) on the surrogate, da (delayed acceptance: surrogate screens proposals, full model corrects, i.e. exact full model posterior), ml (multilevel MCMC on the full model over NS resolutions, see mcmc_ml_levels) or pf (prefetching Metropolis-Hastings on the full model: ranks beyond mcmc_max_chains evaluate the accept/reject tree of the next steps, same samples as mh). (Default: pt) (Type: string. Options: pt|mh|da|ml|pf|mtm)";
+	p.val = "pt";
+	params[var] = p;
+
 	var = "mcmc_num_samples";
 	p.des = "Number of samples to draw using the MCMC solver. (Default: 20000) (Type: size_t)";
 	p.val = "20000";
@@ -185,6 +299,16 @@ void Config::add_params()
 	p.val = "0.1";
 	params[var] = p;
 
+	var = "mcmc_proposal";
+	p.des = "MCMC proposal: randwalk (random walk in one dimension per step, step = mcmc_randwalk_step) or am (adaptive Metropolis: all dimensions, covariance of the chain so far, step scale tuned to mcmc_am_target_acc). (Default: randwalk) (Type: string. Options: randwalk|am)";
+	p.val = "randwalk";
+	params[var] = p;
+
+	var = "mcmc_am_target_acc";
+	p.des = "For adaptive Metropolis only: target acceptance rate of the step scale adaptation. (Default: 0.234) (Type: double in (0.0, 1.0))";
+	p.val = "0.234";
+	params[var] = p;
+
 	var = "mcmc_is_progress";
 	p.des = "Enable to output detail MCMC progress including chain exchange. (Default: no) (Options: yes|no)";
 	p.val = "no";
@@ -196,15 +320,45 @@ void Config::add_params()
 	params[var] = p;
 
 	var = "mcmc_max_chains";
-	p.des = "Maximum number of MCMC chains to be used for Parallel Tempering. Actual number of chains = min(num_mpi_ranks, mcmc_max_chains). (Default: 20) (Type: size_t)";
+	p.des = "Maximum number of MCMC chains to be used for Parallel Tempering. Actual number of chains = min(num_mpi_ranks, mcmc_max_chains / mcmc_chains_per_rank) * mcmc_chains_per_rank. (Default: 20) (Type: size_t)";
+	p.val = "20";
+	params[var] = p;
+
+	var = "mcmc_chains_per_rank";
+	p.des = "Number of MCMC chains advanced together by each rank, their proposals are evaluated in one batch and tempering swaps between them are done in memory. (Default: 1) (Type: size_t)";
+	p.val = "1";
+	params[var] = p;
+
+	var = "mcmc_store_chunk_size";
+	p.des = "Number of MCMC samples per write of the binary sample file, chunks are written by a background thread. (Default: 4096) (Type: size_t)";
+	p.val = "4096";
+	params[var] = p;
+
+	var = "mcmc_mtm_tries";
+	p.des = "For multiple-try Metropolis only: number of tries K per step, selected by posterior weight. Tries and the K-1 reference points of all chains of a rank are evaluated in one batch each, K = 1 is Metropolis-Hastings. (Default: 4) (Type: size_t)";
+	p.val = "4";
+	params[var] = p;
+
+	var = "mcmc_ml_levels";
+	p.des = "For multilevel MCMC only: number of levels L, level l uses NS resolution (ns_resx, ns_resy) / 2^(L-1-l), both must be divisible by 2^(L-1). (Default: 2) (Type: size_t)";
+	p.val = "2";
+	params[var] = p;
+
+	var = "mcmc_ml_pilot_samples";
+	p.des = "For multilevel MCMC only: samples per level to estimate variance and cost, which allocate the samples of the finer levels (level 0 draws mcmc_num_samples). (Default: 20) (Type: size_t)";
 	p.val = "20";
 	params[var] = p;
 
 	var = "mcmc_chain_mixing_rate";
-	p.des = "For Parallel Tempering only: how frequent (percentage in [0.0, 1.0]) to mix chains. (Default: 0.2) (Type: double in [0.0, 1.0])";
+	p.des = "For Parallel Tempering only: how frequent (percentage of MCMC steps in [0.0, 1.0]) to mix chains, each mixing step swaps all even or all odd neighbor pairs in turn. (Default: 0.2) (Type: double in [0.0, 1.0])";
 	p.val = "0.2";
 	params[var] = p;
 
+	var = "mcmc_pt_adapt_steps";
+	p.des = "For Parallel Tempering only: number of burn-in MCMC steps during which the temperatures are adapted towards equal swap acceptance of all neighbor chains (first and last temperature stay fixed), then frozen. 0 = fixed temperatures. (Default: 0) (Type: size_t)";
+	p.val = "0";
+	params[var] = p;
+
 	// Model NS setting
 	var = "ns_domain_size_x";
 	p.des = "Domain size in meters x-direction. (Default: 10.0) (Type: double)";
@@ -70,10 +70,23 @@ public:
 	std::string get_grid_resume_fname() const {return get_param_string("sgi_resume_path")+"/grid.mpibin.bak";}
 	std::string get_data_resume_fname() const {return get_param_string("sgi_resume_path")+"/data.mpibin.bak";}
 	std::string get_pos_resume_fname() const  {return get_param_string("sgi_resume_path")+"/pos.mpibin.bak";}
+	// Single-file SGI checkpoint (grid, alphas, data, pos and metadata)
+	std::string get_ckpt_fname() const {return get_param_string("global_output_path")+"/sgi.ckpt";}
+	std::string get_ckpt_resume_fname() const {return get_param_string("sgi_resume_path")+"/sgi.ckpt";}
+	// Completion journal of the current build phase, and the files of an interrupted phase to resume
+	std::string get_journal_fname() const {return get_param_string("global_output_path")+"/done.mpibin";}
+	std::string get_journal_resume_fname() const {return get_param_string("sgi_resume_path")+"/done.mpibin";}
+	std::string get_data_partial_resume_fname() const {return get_param_string("sgi_resume_path")+"/data.mpibin";}
+	std::string get_pos_partial_resume_fname() const {return get_param_string("sgi_resume_path")+"/pos.mpibin";}
+	// Generated source of the compiled SGI evaluator
+	std::string get_eval_src_fname() const {return get_param_string("global_output_path")+"/sgi_eval.cpp";}
 
 	// Compute the posteria for a given simulation data
 	double compute_posterior(std::vector<double> const& data) const;
 
+	// Compute the log of posteria for a given simulation data (no underflow)
+	double compute_log_posterior(std::vector<double> const& data) const;
+
 private:
 	std::string config_file = ""; // Config_file is optional
 
@@ -21,44 +21,77 @@
 using namespace std;
 
 
+/**
+ * Collective: master generates (or reads) the test points and broadcasts them, the full model
+ * runs are distributed round-robin over all ranks, and all ranks end up with all test data.
+ */
 void ErrorAnalysis::add_test_points(std::size_t n, string test_point_file)
 {
-	std::random_device rd;
-	std::mt19937 eng (rd());
-	pair<double,double> range;
+#if (IMPI==1)
+	// JOINING ranks get the test points at the first error evaluation (see sync_test_points)
+	if (par.status == MPI_ADAPT_STATUS_JOINING) return;
+#endif
 	std::size_t input_size = cfg.get_input_size();
-	test_points.resize(n);
-	test_points_data.resize(n);
+	std::size_t output_size = cfg.get_output_size();
 
-	// Generate or read test points
-	if (test_point_file == "") {
-		par.info();
-		printf("EA: adding test points...\n");
-		for (std::size_t k=0; k < n; ++k) {
-			test_points[k].resize(input_size);
-			for (std::size_t i=0; i < input_size; ++i) {
-				range = fullmodel.get_input_space(i);
-				uniform_real_distribution<double> udist (range.first, range.second);
-				test_points[k][i] = udist(eng);
+	// Master generates or reads test points
+	if (par.is_master()) {
+		if (test_point_file == "") {
+			RandomStream rng (RNG_STREAM_EA);
+			pair<double,double> range;
+			par.info();
+			printf("EA: adding test points...\n");
+			test_points.resize(n);
+			for (std::size_t k=0; k < n; ++k) {
+				test_points[k].resize(input_size);
+				for (std::size_t i=0; i < input_size; ++i) {
+					range = fullmodel.get_input_space(i);
+					test_points[k][i] = rng.uniform(range.first, range.second);
+				}
 			}
+		} else {
+			par.info();
+			printf("EA: reading test points...\n");
+			read_test_points(test_point_file);
 		}
-	} else {
-		par.info();
-		printf("EA: reading test points...\n");
-		read_test_points(test_point_file);
+		n = test_points.size();
 	}
-	// Compute output data for each test point with full model
+	MPI_Bcast(&n, 1, MPI_SIZE_T, par.master, MPI_COMM_WORLD);
+	unique_ptr<double[]> buf (new double[n * std::max(input_size, output_size)]);
+	if (par.is_master()) {
+		for (std::size_t k=0; k < n; ++k)
+			std::copy(test_points[k].begin(), test_points[k].end(), &buf[k*input_size]);
+	}
+	MPI_Bcast(&buf[0], n*input_size, MPI_DOUBLE, par.master, MPI_COMM_WORLD);
+	test_points.resize(n);
+	for (std::size_t k=0; k < n; ++k)
+		test_points[k].assign(&buf[k*input_size], &buf[(k+1)*input_size]);
+
+	// Compute output data for each test point with full model, round-robin over ranks
 	double tic;
-	double avg_fullmodel_time = 0.0;
-	test_points_data.clear();
-	for (auto it=test_points.begin(); it != test_points.end(); ++it) {
+	double times[2] = {0.0, MPI_Wtime()}; // sum of model times, wall time
+	std::fill(&buf[0], &buf[n*output_size], 0.0);
+	for (std::size_t k=par.rank; k < n; k += par.size) {
 		tic = MPI_Wtime();
-		test_points_data.push_back( fullmodel.run(*it) );
-		avg_fullmodel_time += MPI_Wtime()-tic;
+		vector<double> d = fullmodel.run(test_points[k]);
+		times[0] += MPI_Wtime()-tic;
+		if (d.size() != output_size) {
+			par.info();
+			printf("ERROR: EA full model output size %lu != %lu. Program abort!\n", d.size(), output_size);
+			exit(EXIT_FAILURE);
+		}
+		std::copy(d.begin(), d.end(), &buf[k*output_size]);
+	}
+	MPI_Allreduce(MPI_IN_PLACE, &buf[0], n*output_size, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+	MPI_Allreduce(MPI_IN_PLACE, &times[0], 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+	test_points_data.resize(n);
+	for (std::size_t k=0; k < n; ++k)
+		test_points_data[k].assign(&buf[k*output_size], &buf[(k+1)*output_size]);
+	if (par.is_master()) {
+		par.info();
+		printf("EA: %lu test points on %d ranks in %.06f sec, average full moddel exec.time(sec) %.06f\n",
+				n, par.size, MPI_Wtime()-times[1], (n > 0) ? times[0]/double(n) : 0.0);
 	}
-	avg_fullmodel_time /= n;
-	par.info();
-	printf("EA: average full moddel exec.time(sec) %.06f\n", avg_fullmodel_time);
 }
 
 void ErrorAnalysis::add_test_point_at(vector<double> const& m)
@@ -88,22 +121,75 @@ double ErrorAnalysis::compute_surrogate_error()
 		exit(EXIT_FAILURE);
 	}
 	std::size_t n = test_points.size();
-	double denom, err, sum = 0.0;
-	for (int i=0; i < n; ++i) {
-		// err := l2norm( g(x) - f(x) ) / l2norm( g(x) + f(x) )
-		// err in [0.0, 1.0]
-		denom = tools::compute_l2norm_sum(test_points_data[i], surrogate.run(test_points[i]));
-		if (denom == 0.0) {
-			err = 0.0;
-		} else {
-			err = tools::compute_l2norm_diff(test_points_data[i], surrogate.run(test_points[i])) / denom;
-			if (std::isnan(err) || std::isinf(err) || err > 1.0) err = 1.0;
-		}
-		sum += err;
+	double sum = 0.0;
+	for (std::size_t i=0; i < n; ++i) {
+		sum += compute_error(test_points_data[i], surrogate.run(test_points[i]));
+	}
+	return sum/double(n);
+}
+
+/**
+ * Collective: each rank evaluates the surrogate on its round-robin batch of the test points,
+ * the errors are summed over all ranks.
+ */
+double ErrorAnalysis::compute_surrogate_error_parallel()
+{
+	sync_test_points();
+	if (test_points.size() < 1) {
+		par.info();
+		printf("ERROR: EA compute surrogate error failed due to no test points. Program abort!\n");
+		exit(EXIT_FAILURE);
+	}
+	std::size_t n = test_points.size();
+	double sum = 0.0;
+	for (std::size_t i=par.rank; i < n; i += par.size) {
+		sum += compute_error(test_points_data[i], surrogate.run(test_points[i]));
 	}
+	MPI_Allreduce(MPI_IN_PLACE, &sum, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
 	return sum/double(n);
 }
 
+/**
+ * Ranks without the test set of the master (e.g. JOINING ranks) receive it from the master
+ */
+void ErrorAnalysis::sync_test_points()
+{
+	std::size_t input_size = cfg.get_input_size();
+	std::size_t output_size = cfg.get_output_size();
+	std::size_t n = test_points.size();
+	MPI_Bcast(&n, 1, MPI_SIZE_T, par.master, MPI_COMM_WORLD);
+	int is_sync = (test_points.size() == n && test_points_data.size() == n) ? 1 : 0;
+	MPI_Allreduce(MPI_IN_PLACE, &is_sync, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+	if (is_sync) return;
+
+	std::size_t row = input_size + output_size;
+	unique_ptr<double[]> buf (new double[n * row]);
+	if (par.is_master()) {
+		for (std::size_t k=0; k < n; ++k) {
+			std::copy(test_points[k].begin(), test_points[k].end(), &buf[k*row]);
+			std::copy(test_points_data[k].begin(), test_points_data[k].end(), &buf[k*row+input_size]);
+		}
+	}
+	MPI_Bcast(&buf[0], n*row, MPI_DOUBLE, par.master, MPI_COMM_WORLD);
+	test_points.resize(n);
+	test_points_data.resize(n);
+	for (std::size_t k=0; k < n; ++k) {
+		test_points[k].assign(&buf[k*row], &buf[k*row+input_size]);
+		test_points_data[k].assign(&buf[k*row+input_size], &buf[(k+1)*row]);
+	}
+	return;
+}
+
+// err := l2norm( g(x) - f(x) ) / l2norm( g(x) + f(x) ), err in [0.0, 1.0]
+double ErrorAnalysis::compute_error(vector<double> const& fd, vector<double> const& sd)
+{
+	double denom = tools::compute_l2norm_sum(fd, sd);
+	if (denom == 0.0) return 0.0;
+	double err = tools::compute_l2norm_diff(fd, sd) / denom;
+	if (std::isnan(err) || std::isinf(err) || err > 1.0) err = 1.0;
+	return err;
+}
+
 double ErrorAnalysis::compute_surrogate_error_at(std::vector<double> const& m)
 {
 	vector<double> fd = fullmodel.run(m);
@@ -139,29 +225,42 @@ bool ErrorAnalysis::eval_model_spmd(double tol)
 
 
 /**
- * This function only MASTER does the surrogate error eval, then it Bcast error to other ranks
+ * All ranks evaluate the surrogate error (see compute_surrogate_error_parallel), master reports it
  */
-bool ErrorAnalysis::eval_model_master(double tol)
+bool ErrorAnalysis::eval_model_parallel(double tol)
 {
-	double err = 0.0;
-
+	double err = compute_surrogate_error_parallel();
 	if (par.is_master()) {
-		err = compute_surrogate_error();
+		fflush(NULL);
+		printf("EA: Surrogate error %.8f | tol %.2f\n", err, tol);
 	}
-	MPI_Bcast(&err, 1, MPI_DOUBLE, par.master, MPI_COMM_WORLD);
-	err = err/double(par.size);
+	return (err <= tol) ? true : false;
+}
+
+
+/**
+ * Only the calling rank evaluates all test points, no communication (e.g. MASTER during a pipelined SGI build)
+ */
+bool ErrorAnalysis::eval_model_local(double tol)
+{
+	double err = compute_surrogate_error();
+	fflush(NULL);
+	printf("EA: Surrogate error %.8f | tol %.2f\n", err, tol);
+	return (err <= tol) ? true : false;
+}
 
-#if (EA_LOCALINFO == 1)
-	par.info();
-	printf("EA: %lu test points, local error %.8f, global error %.8f\n",
-			test_points.size(), local_err, err);
-#endif
 
+/**
+ * All ranks evaluate the surrogate error (see compute_surrogate_error_parallel), master reports it
+ */
+double ErrorAnalysis::eval_error_parallel()
+{
+	double err = compute_surrogate_error_parallel();
 	if (par.is_master()) {
 		fflush(NULL);
-		printf("EA: Surrogate error %.8f | tol %.2f\n", err, tol);
+		printf("EA: Surrogate error %.8f\n", err);
 	}
-	return (err <= tol) ? true : false;
+	return err;
 }
 
 
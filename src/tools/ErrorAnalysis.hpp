@@ -22,15 +22,17 @@
 #include <tools/Config.hpp>
 #include <tools/Parallel.hpp>
 #include <model/ForwardModel.hpp>
+#include <tools/RandomStream.hpp>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <string>
 #include <iomanip> //for std::setprecision
 #include <vector>
-#include <random>
 #include <cmath> //for isinf() isnan()
 #include <cstdlib> //for atof()
+#include <memory>
+#include <algorithm>
 
 
 class ErrorAnalysis {
@@ -43,6 +45,10 @@ private:
 	std::vector< std::vector<double> >	test_points;
 	std::vector< std::vector<double> >	test_points_data;
 
+	double compute_error(std::vector<double> const& fd, std::vector<double> const& sd);
+
+	void sync_test_points();
+
 public:
 	~ErrorAnalysis() {}
 
@@ -71,7 +77,12 @@ public:
 
 	double compute_surrogate_error_at(std::vector<double> const& m);
 
-	bool eval_model_master(double tol);
+	double compute_surrogate_error_parallel();
+
+	double eval_error_parallel();
+
+	bool eval_model_parallel(double tol);
+	bool eval_model_local(double tol);
 	bool eval_model_spmd(double tol);
 };
 #endif /* TOOLS_ERRORANALYSIS_HPP_ */
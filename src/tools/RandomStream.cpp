@@ -0,0 +1,130 @@
+// eBayes - Elastic Bayesian Inference Framework with iMPI
+// Copyright (C) 2015-today Ao Mo-Hellenbrand
+//
+// All copyrights remain with the respective authors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <tools/RandomStream.hpp>
+
+#include <random>
+
+using namespace std;
+
+uint64_t RandomStream::seed = 0;
+bool RandomStream::is_seed = false;
+
+
+RandomStream::RandomStream(uint64_t s, uint32_t id)
+	: stream(id)
+{
+	key[0] = uint32_t(s);
+	key[1] = uint32_t(s >> 32);
+	set_step(0);
+}
+
+void RandomStream::set_step(uint64_t s)
+{
+	step = s;
+	block = 0;
+	buf_pos = 4;
+	has_spare = false;
+	return;
+}
+
+void RandomStream::generate()
+{
+	const uint32_t M0 = 0xD2511F53u, M1 = 0xCD9E8D57u;
+	const uint32_t W0 = 0x9E3779B9u, W1 = 0xBB67AE85u;
+	uint32_t c[4] = {block, uint32_t(step), uint32_t(step >> 32), stream};
+	uint32_t k0 = key[0], k1 = key[1];
+	for (int r=0; r < 10; r++) {
+		uint64_t p0 = uint64_t(M0) * c[0];
+		uint64_t p1 = uint64_t(M1) * c[2];
+		uint32_t n0 = uint32_t(p1 >> 32) ^ c[1] ^ k0;
+		uint32_t n2 = uint32_t(p0 >> 32) ^ c[3] ^ k1;
+		c[0] = n0;
+		c[1] = uint32_t(p1);
+		c[2] = n2;
+		c[3] = uint32_t(p0);
+		k0 += W0;
+		k1 += W1;
+	}
+	std::copy(c, c+4, buf);
+	buf_pos = 0;
+	block++;
+	return;
+}
+
+std::size_t RandomStream::uniform_int(std::size_t n)
+{
+	std::size_t r = std::size_t(uniform() * double(n));
+	return (r < n) ? r : n-1;
+}
+
+double RandomStream::normal(double mean, double sigma)
+{
+	if (has_spare) {
+		has_spare = false;
+		return mean + sigma * spare;
+	}
+	// Box-Muller
+	double r = sqrt(-2.0 * log(uniform()));
+	double t = 2.0 * M_PI * uniform();
+	spare = r * sin(t);
+	has_spare = true;
+	return mean + sigma * r * cos(t);
+}
+
+void RandomStream::uniform(double* out, std::size_t n)
+{
+	for (std::size_t i=0; i < n; i++)
+		out[i] = uniform();
+	return;
+}
+
+void RandomStream::normal(double* out, std::size_t n)
+{
+	for (std::size_t i=0; i < n; i++)
+		out[i] = normal();
+	return;
+}
+
+uint64_t RandomStream::init_seed(Config const& cfg, Parallel& par)
+{
+	seed = cfg.get_param_sizet("global_seed");
+	if (seed == 0) {
+		if (par.is_master()) {
+			std::random_device rd;
+			seed = (uint64_t(rd()) << 32) | rd();
+		}
+		MPI_Bcast(&seed, 1, MPI_UINT64_T, par.master, MPI_COMM_WORLD);
+	}
+	is_seed = true;
+	if (par.is_master()) {
+		fflush(NULL);
+		printf("RNG: seed %lu (set global_seed to reproduce this run)\n", seed);
+	}
+	return seed;
+}
+
+uint64_t RandomStream::get_seed()
+{
+	if (!is_seed) {
+		printf("ERROR: RandomStream seed is not initialized (call init_seed after MPI init). Program abort!\n");
+		exit(EXIT_FAILURE);
+	}
+	return seed;
+}
@@ -0,0 +1,101 @@
+// eBayes - Elastic Bayesian Inference Framework with iMPI
+// Copyright (C) 2015-today Ao Mo-Hellenbrand
+//
+// All copyrights remain with the respective authors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef TOOLS_RANDOMSTREAM_HPP_
+#define TOOLS_RANDOMSTREAM_HPP_
+
+#include <tools/Config.hpp>
+#include <tools/Parallel.hpp>
+
+#include <mpi.h>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+
+// Streams besides the MCMC chains (chain c uses stream c)
+#define RNG_STREAM_EA	0xFFFFFFF0u	// ErrorAnalysis test points
+#define RNG_STREAM_PT	0xFFFFFFF1u	// Parallel Tempering exchange schedule
+#define RNG_STREAM_SGI	0xFFFFFFF2u	// SGI consistency check points
+
+/**
+ * Counter-based random numbers (Philox4x32-10). The i-th draw of step s in stream c is
+ * a pure function of (seed, c, s, i): no generator state to seed or share, streams of
+ * different chains never overlap, and a run is reproducible for a given global_seed.
+ */
+class RandomStream
+{
+public:
+	~RandomStream() {}
+
+	RandomStream(uint64_t seed, uint32_t stream);
+
+	// Uses the seed from init_seed()
+	explicit RandomStream(uint32_t stream) : RandomStream(get_seed(), stream) {}
+
+	// Move to the first draw of step s
+	void set_step(uint64_t s);
+
+	void next_step() {set_step(step + 1);}
+
+	uint64_t get_step() const {return step;}
+
+	// Uniform in (0, 1)
+	double uniform() {return (double(next64() >> 11) + 0.5) * (1.0 / 9007199254740992.0);}
+
+	double uniform(double a, double b) {return a + (b-a) * uniform();}
+
+	// Uniform integer in [0, n)
+	std::size_t uniform_int(std::size_t n);
+
+	double normal(double mean = 0.0, double sigma = 1.0);
+
+	// Vectorized draws
+	void uniform(double* out, std::size_t n);
+
+	void normal(double* out, std::size_t n);
+
+	// Collective, call once after MPI init: global_seed, or if 0 a seed drawn by MASTER and Bcast
+	static uint64_t init_seed(Config const& cfg, Parallel& par);
+
+	static uint64_t get_seed();
+
+private:
+	uint32_t	key[2];
+	uint32_t	stream;
+	uint64_t	step = 0;
+	uint32_t	block = 0;	// Philox blocks used in this step
+	uint32_t	buf[4];
+	int			buf_pos = 4;	// next unused word of buf (4 = empty)
+	bool		has_spare = false;	// Box-Muller gives pairs
+	double		spare = 0.0;
+
+	static uint64_t	seed;
+	static bool		is_seed;
+
+	// Philox4x32-10 of counter {block, step, stream} into buf
+	void generate();
+
+	uint64_t next64() {
+		if (buf_pos > 2) generate();
+		uint64_t r = (uint64_t(buf[buf_pos]) << 32) | buf[buf_pos+1];
+		buf_pos += 2;
+		return r;
+	}
+};
+#endif /* TOOLS_RANDOMSTREAM_HPP_ */